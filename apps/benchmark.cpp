@@ -4,34 +4,131 @@
 #include "scheduler.h"
 #include <stdlib.h>
 #include "parallelArray.h"
+#include "parallelExpr.h"
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
+#include <math.h>
+#include <numeric>
+#include <limits>
+#include <stdint.h>
+#include <algorithm>
 #include "parallelMatrix.h"
+#include "simdKernels.h"
+#include <iomanip>
+#include <limits.h>
 
 #define NWORKERS 16
 
-void init_arr(int* arr, int size){
+//names of the element types the benchmarks sweep
+template<typename T> const char* type_name();
+template<> const char* type_name<int>() { return "int"; }
+template<> const char* type_name<int64_t>() { return "int64_t"; }
+template<> const char* type_name<float>() { return "float"; }
+template<> const char* type_name<double>() { return "double"; }
+
+//how far a result may be off relative to its exact value, integer results must be exact,
+//floating point ones are allowed the rounding of about 10^4 sequential operations
+template<typename T>
+double tolerance(){
+    return std::numeric_limits<T>::epsilon() * 1e4;
+}
+
+//small values, so that products of them fit any of the element types, and so do sums of
+//up to 2^27 of them, see scan_fits()
+template<typename T>
+void init_arr(T* arr, int size){
 
-    for (int i = 1; i <= size; i++){
-        arr[i-1] = i;
+    for (int i = 0; i < size; i++){
+        arr[i] = (T)(i % 16 + 1);
     }
 
 
 }
 
-void init_matrix(int * arr, int size){
+template<typename T>
+void init_matrix(T* arr, int size){
+
+    for (int i = 0; i < size; i++){
+        for (int j = 0; j < size; j++){
+            arr[GET_IDX(i, j, size)] = (T)GET_IDX(i, j, size);
+        }
+    }
+
+}
+
+//checks a matrix set up by init_matrix, and transposed if transposed is set
+template<typename T>
+void check_matrix(T* arr, int size, bool transposed){
 
     for (int i = 0; i < size; i++){
         for (int j = 0; j < size; j++){
-            arr[GET_IDX(i, j, size)] = j;
+            assert(arr[GET_IDX(i, j, size)] == (T)(transposed ? GET_IDX(j, i, size) : GET_IDX(i, j, size)));
+        }
+    }
+
+}
+
+//checks both transposes on a matrix whose size is not a power of two
+template<typename T>
+void check_transposes(int size){
+
+    T* in = new T[size*size];
+    T* out = new T[size*size];
+
+    init_matrix(in, size);
+    BENCHMARKS::parallelMatrixTranspose(out, (const T*)in, size);
+    check_matrix(out, size, true);
+    check_matrix(in, size, false);
+
+    BENCHMARKS::parallelMatrixTranspose(in, size);
+    check_matrix(in, size, true);
+
+    delete[] in;
+    delete[] out;
+
+}
+
+//checks a scan of in, integer scans exactly against std::inclusive_scan and
+//std::exclusive_scan, floating point ones against sums kept in double, as a sequential
+//float scan drifts off on large arrays
+template<typename T>
+void check_scan(const T* in, const T* out, int size, bool exclusive){
+
+    if constexpr (std::is_integral<T>::value){
+        T* expected = new T[size];
+        if (exclusive){
+            std::exclusive_scan(in, in + size, expected, T(0));
+        } else {
+            std::inclusive_scan(in, in + size, expected);
+        }
+        assert(std::equal(out, out + size, expected));
+        delete[] expected;
+    } else {
+        double sum = 0;
+        for (int i = 0; i < size; i++){
+            if (!exclusive){
+                sum += in[i];
+            }
+            assert(fabs(out[i] - sum) <= tolerance<T>() * sum);
+            if (exclusive){
+                sum += in[i];
+            }
         }
     }
 
 }
 
+//can a scan of size elements set up by init_arr be held in T?
+template<typename T>
+bool scan_fits(int size){
+    //every 16 elements add up to 136
+    return 136.0 * (size / 16 + 1) <= (double)std::numeric_limits<T>::max();
+}
+
 
-void print_arr(int* arr, int size){
+template<typename T>
+void print_arr(T* arr, int size){
 
     for (int i = 0; i < size; i ++){
 
@@ -44,7 +141,8 @@ void print_arr(int* arr, int size){
 
 }
 
-void print_matrix(int * matrix, int size){
+template<typename T>
+void print_matrix(T* matrix, int size){
 
     for (int i = 0; i < size; i ++){
         print_arr(&matrix[i*size], size);
@@ -56,13 +154,52 @@ double t2d(struct timeval *t) {
     return t->tv_sec*1000000.0 + t->tv_usec;
 }
 
+//multiplies two (size x size) matrices of small values, timing the multiplies and then
+//checking a sample of rows of the product against a plain triple loop
+template<typename T>
+void timed_mat_multiply(int size, int iterations, struct timeval* before, struct timeval* after){
+
+    T* A = new T[size*size];
+    T* B = new T[size*size];
+    T* out = new T[size*size];
+
+    for (int i = 0; i < size; i++){
+        for (int j = 0; j < size; j++){
+            A[GET_IDX(i, j, size)] = (T)((i*7 + j*3) % 11) - 5;
+            B[GET_IDX(i, j, size)] = (T)((i*5 + j*2) % 13) - 6;
+        }
+    }
+
+    gettimeofday(before, NULL);
+    for (int i = 0; i < iterations; i++){
+        BENCHMARKS::parallelMatrixMultiply(out, (const T*)A, (const T*)B, size);
+    }
+    gettimeofday(after, NULL);
+
+    for (int i = 0; i < size; i += size / 16 + 1){
+        for (int j = 0; j < size; j++){
+            double expected = 0;
+            for (int k = 0; k < size; k++){
+                expected += (double)A[GET_IDX(i, k, size)] * B[GET_IDX(k, j, size)];
+            }
+            assert(fabs(out[GET_IDX(i, j, size)] - expected) <= 1e-4 * fabs(expected) + 1e-3);
+        }
+    }
+
+    delete[] A;
+    delete[] B;
+    delete[] out;
+
+}
+
+//runs one of the benchmarks on arrays of T, and returns its runtime per iteration
+template<typename T>
 double do_timed_run(const char* app, int size, int iterations){
 
     struct timeval before, after;
     int i;
     double time;
-    int *arr1, *arr2, *arr3;
-    int result;
+    T *arr1, *arr2, *arr3;
 
 
     /************************************************************/
@@ -70,9 +207,9 @@ double do_timed_run(const char* app, int size, int iterations){
     /************************************************************/
     if (!strcmp(app, "parallelAdd")) {
 
-        arr1 = new int[size];
-        arr2 = new int[size];
-        arr3 = new int[size];
+        arr1 = new T[size];
+        arr2 = new T[size];
+        arr3 = new T[size];
 
         init_arr(arr1, size);
         init_arr(arr2, size);
@@ -84,9 +221,13 @@ double do_timed_run(const char* app, int size, int iterations){
         }
         gettimeofday(&after, NULL);
 
-        delete arr1;
-        delete arr2;
-        delete arr3;
+        for (i = 0; i < size; i++){
+            assert(arr3[i] == arr1[i] + arr2[i]);
+        }
+
+        delete[] arr1;
+        delete[] arr2;
+        delete[] arr3;
 
 
     }
@@ -96,9 +237,9 @@ double do_timed_run(const char* app, int size, int iterations){
     /************************************************************/
     if (!strcmp(app, "parallelMultiply")) {
 
-        arr1 = new int[size];
-        arr2 = new int[size];
-        arr3 = new int[size];
+        arr1 = new T[size];
+        arr2 = new T[size];
+        arr3 = new T[size];
 
         init_arr(arr1, size);
         init_arr(arr2, size);
@@ -110,9 +251,13 @@ double do_timed_run(const char* app, int size, int iterations){
         }
         gettimeofday(&after, NULL);
 
-        delete arr1;
-        delete arr2;
-        delete arr3;
+        for (i = 0; i < size; i++){
+            assert(arr3[i] == arr1[i] * arr2[i]);
+        }
+
+        delete[] arr1;
+        delete[] arr2;
+        delete[] arr3;
 
 
     }
@@ -122,8 +267,8 @@ double do_timed_run(const char* app, int size, int iterations){
     /************************************************************/
     if (!strcmp(app, "parallelCopy")) {
 
-        arr1 = new int[size];
-        arr2 = new int[size];
+        arr1 = new T[size];
+        arr2 = new T[size];
 
         init_arr(arr1, size);
 
@@ -133,8 +278,10 @@ double do_timed_run(const char* app, int size, int iterations){
         }
         gettimeofday(&after, NULL);
 
-        delete arr1;
-        delete arr2;
+        assert(std::equal(arr1, arr1 + size, arr2));
+
+        delete[] arr1;
+        delete[] arr2;
 
     }
 
@@ -143,70 +290,191 @@ double do_timed_run(const char* app, int size, int iterations){
     /************************************************************/
     if (!strcmp(app, "parallelReduce")){
 
-        arr1 = new int[size];
+        arr1 = new T[size];
 
         init_arr(arr1, size);
+        double expected = std::accumulate(arr1, arr1 + size, 0.0);
+
+        gettimeofday(&before, NULL);
+        for (i = 0; i < iterations; i++){
+            //integers are summed as 64 bits, so this does not wrap around
+            BENCHMARKS::SumType<T> sum = BENCHMARKS::parallelReduce(arr1, size);
+            assert(fabs(sum - expected) <= tolerance<T>() * expected);
+        }
+        gettimeofday(&after, NULL);
+
+        delete[] arr1;
+
+    }
+
+    //only exists for int
+    if (!strcmp(app, "parallelReduceLegacy")){
+
+        int* in = new int[size];
+
+        init_arr(in, size);
+        int expected = std::accumulate(in, in + size, 0);
 
         gettimeofday(&before, NULL);
         for (i = 0; i < iterations; i++){
-            result = BENCHMARKS::parallelReduce(arr1, size);
-            assert(result == ((size*(size+1))/2));
+            int result = BENCHMARKS::parallelReduceLegacy(in, size);
+            assert(result == expected);
         }
         gettimeofday(&after, NULL);
 
-        delete arr1;
+        delete[] in;
 
     }
 
     /************************************************************/
-    /*                 Parallel Transpose                       */
+    /*                 Parallel Scan                            */
     /************************************************************/
-    if (!strcmp(app, "parallelTranspose")){
+    if (!strcmp(app, "parallelScan")){
 
-        arr1 = new int[size*size];
+        arr1 = new T[size];
+        arr2 = new T[size];
 
-        init_matrix(arr1, size);
+        init_arr(arr1, size);
 
         gettimeofday(&before, NULL);
         for (i = 0; i < iterations; i++){
-            BENCHMARKS::parallelMatrixTranspose(arr1, size);
+            BENCHMARKS::parallelScan(arr2, arr1, size);
         }
         gettimeofday(&after, NULL);
 
-        delete arr1;
+        check_scan(arr1, arr2, size, false);
+
+        BENCHMARKS::parallelScan(arr2, arr1, size, true);
+        check_scan(arr1, arr2, size, true);
+
+        delete[] arr1;
+        delete[] arr2;
 
     }
 
     /************************************************************/
-    /*                 Parallel Mat Multiply                    */
+    /*                 Parallel Fused Expressions               */
     /************************************************************/
-    if (!strcmp(app, "parallelMatMultiply")){
+    if (!strcmp(app, "parallelUnfused") || !strcmp(app, "parallelFused")){
+
+        //out = (a + b) * c, through a temporary array or in a single pass
+        arr1 = new T[size];
+        arr2 = new T[size];
+        arr3 = new T[size];
+        T* tmp = new T[size];
+        T* out = new T[size];
+
+        init_arr(arr1, size);
+        init_arr(arr2, size);
+        init_arr(arr3, size);
+
+        gettimeofday(&before, NULL);
+        for (i = 0; i < iterations; i++){
+            if (!strcmp(app, "parallelUnfused")){
+                BENCHMARKS::parallelAdd(tmp, arr1, arr2, size);
+                BENCHMARKS::parallelMultiply(out, tmp, arr3, size);
+            } else {
+                BENCHMARKS::parallelEval(out, (BENCHMARKS::expr(arr1) + BENCHMARKS::expr(arr2)) * BENCHMARKS::expr(arr3), size);
+            }
+        }
+        gettimeofday(&after, NULL);
 
+        for (i = 0; i < size; i++){
+            assert(out[i] == (arr1[i] + arr2[i]) * arr3[i]);
+        }
+
+        delete[] arr1;
+        delete[] arr2;
+        delete[] arr3;
+        delete[] tmp;
+        delete[] out;
+
+    }
+
+    if (!strcmp(app, "parallelDotUnfused") || !strcmp(app, "parallelDot")){
 
-        arr1 = new int[size*size];
-        arr2 = new int[size*size];
-        arr3 = new int[size*size];
+        //sum of a[i] * b[i], through a temporary array or in a single pass
+        arr1 = new T[size];
+        arr2 = new T[size];
+        T* tmp = new T[size];
+
+        init_arr(arr1, size);
+        init_arr(arr2, size);
+
+        double expected = 0;
+        for (i = 0; i < size; i++){
+            expected += (double)arr1[i] * arr2[i];
+        }
+
+        gettimeofday(&before, NULL);
+        for (i = 0; i < iterations; i++){
+            BENCHMARKS::SumType<T> dot;
+            if (!strcmp(app, "parallelDotUnfused")){
+                BENCHMARKS::parallelMultiply(tmp, arr1, arr2, size);
+                dot = BENCHMARKS::parallelReduce(tmp, size);
+            } else {
+                dot = BENCHMARKS::parallelReduce(BENCHMARKS::expr(arr1) * BENCHMARKS::expr(arr2), size);
+            }
+            assert(fabs(dot - expected) <= tolerance<T>() * expected);
+        }
+        gettimeofday(&after, NULL);
+
+        delete[] arr1;
+        delete[] arr2;
+        delete[] tmp;
+
+    }
+
+    /************************************************************/
+    /*                 Parallel Transpose                       */
+    /************************************************************/
+    if (!strcmp(app, "parallelTranspose")){
+
+        check_transposes<T>(size + 5);
+
+        arr1 = new T[size*size];
 
         init_matrix(arr1, size);
-        init_matrix(arr2, size);
 
-	//end result will be matrix of all elements of the same value
-        BENCHMARKS::parallelMatrixTranspose(arr2, size);
+        gettimeofday(&before, NULL);
+        for (i = 0; i < iterations; i++){
+            BENCHMARKS::parallelMatrixTranspose(arr1, size);
+        }
+        gettimeofday(&after, NULL);
+
+        check_matrix(arr1, size, iterations % 2 == 1);
+
+        delete[] arr1;
+
+    }
+
+    if (!strcmp(app, "parallelTransposeOut")){
+
+        arr1 = new T[size*size];
+        arr2 = new T[size*size];
 
+        init_matrix(arr1, size);
 
         gettimeofday(&before, NULL);
         for (i = 0; i < iterations; i++){
-            BENCHMARKS::parallelMatrixMultiply(arr3, arr1, arr2, size);
+            BENCHMARKS::parallelMatrixTranspose(arr2, (const T*)arr1, size);
         }
         gettimeofday(&after, NULL);
 
+        check_matrix(arr2, size, true);
 
-        delete arr1;
-        delete arr2;
-        delete arr3;
+        delete[] arr1;
+        delete[] arr2;
 
     }
 
+    /************************************************************/
+    /*                 Parallel Mat Multiply                    */
+    /************************************************************/
+    if (!strcmp(app, "parallelMatMultiply")){
+        timed_mat_multiply<T>(size, iterations, &before, &after);
+    }
+
 
     time = t2d(&after) - t2d(&before);
 
@@ -215,11 +483,132 @@ double do_timed_run(const char* app, int size, int iterations){
 }
 
 
+//prints the bandwidth one of the element-wise benchmarks achieves on arrays of T, counting
+//every one of the arrays it works on read or written once
+template<typename T>
+void report_kernel(const char* app, const char* kernel, int arrays, int size, int iterations, double roof){
+
+    double bandwidth = (double)arrays * size * sizeof(T) / do_timed_run<T>(app, size, iterations) / 1e3;
+
+    std::cout << std::left << std::setw(20) << kernel << std::setw(8) << BENCHMARKS::simdLevelName(BENCHMARKS::simdLevel())
+              << std::right << std::setw(10) << std::fixed << std::setprecision(2) << bandwidth
+              << std::setw(10) << std::setprecision(1) << 100 * bandwidth / roof << "%" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+
+}
+
+//runs the element-wise benchmarks with the kernels of every instruction set the cpu
+//supports, and prints the bandwidth of each against the memory bandwidth roof
+void report_kernels(int size, int iterations){
+
+    //the roof is MEM_BANDWIDTH in GB/s, e.g. from STREAM, or else the best bandwidth of
+    //three parallel copies with the C library's memcpy, as tuned for the cpu as it gets.
+    //Unlike the rows, the best of the three does not include the page faults of writing
+    //to freshly allocated memory, so the rows get closer to it with more iterations
+    double roof = 0;
+    if (getenv("MEM_BANDWIDTH") != NULL){
+        roof = atof(getenv("MEM_BANDWIDTH"));
+    } else {
+        int* in = new int[size];
+        int* out = new int[size];
+        init_arr(in, size);
+
+        for (int i = 0; i < 3; i++){
+            struct timeval before, after;
+            gettimeofday(&before, NULL);
+            for (int j = 0; j < iterations; j++){
+                WSDS::parallel_for(0L, (long)size, (long)BENCHMARKS::work_per_subtask, [=](long begin, long end){
+                    memcpy(out + begin, in + begin, (end - begin) * sizeof(int));
+                }, BENCHMARKS::parSched);
+            }
+            gettimeofday(&after, NULL);
+            roof = std::max(roof, 2.0 * size * sizeof(int) * iterations / (t2d(&after) - t2d(&before)) / 1e3);
+        }
+
+        delete[] in;
+        delete[] out;
+    }
+
+    std::cout << "Running SIMD kernels, against a roof of " << roof << " GB/s:" << std::endl;
+    std::cout << std::left << std::setw(20) << "kernel" << std::setw(8) << "simd"
+              << std::right << std::setw(10) << "GB/s" << std::setw(11) << "of roof" << std::endl;
+
+    long threshold = BENCHMARKS::streamingThreshold();
+
+    for (int level = BENCHMARKS::SIMD_NONE; level <= BENCHMARKS::simdSupported(); level++){
+        BENCHMARKS::setSimdLevel((BENCHMARKS::SimdLevel)level);
+
+        report_kernel<int>("parallelAdd", "add (int)", 3, size, iterations, roof);
+        report_kernel<float>("parallelAdd", "add (float)", 3, size, iterations, roof);
+        report_kernel<double>("parallelAdd", "add (double)", 3, size, iterations, roof);
+        report_kernel<int>("parallelMultiply", "multiply (int)", 3, size, iterations, roof);
+        report_kernel<float>("parallelMultiply", "multiply (float)", 3, size, iterations, roof);
+        report_kernel<double>("parallelMultiply", "multiply (double)", 3, size, iterations, roof);
+
+        BENCHMARKS::setStreamingThreshold(LONG_MAX);
+        report_kernel<int>("parallelCopy", "copy", 2, size, iterations, roof);
+        BENCHMARKS::setStreamingThreshold(0);
+        report_kernel<int>("parallelCopy", "copy (streamed)", 2, size, iterations, roof);
+        BENCHMARKS::setStreamingThreshold(threshold);
+    }
+
+    BENCHMARKS::setSimdLevel(BENCHMARKS::simdSupported());
+    std::cout << std::endl;
+
+}
+
+//runs one of the benchmarks on arrays of T and prints its runtime and the scheduler stats
+template<typename T>
+double report_run(WSDS::Scheduler* scheduler, const char* app, const char* name, int size, int iterations){
+
+    std::cout << "Running " << name << " (" << type_name<T>() << "):" << std::endl;
+    scheduler->reset_stats();
+    double runtime = do_timed_run<T>(app, size, iterations);
+    std::cout << "Result: " << runtime << " us" << std::endl;
+    scheduler->stats().print(std::cout);
+    std::cout << std::endl;
+
+    return runtime;
+
+}
+
+//runs one of the benchmarks for every element type, passing each runtime, the size of
+//the element type and whether it is an integer type to report, which may print figures
+//derived from them
+template<typename Report>
+void sweep_types(WSDS::Scheduler* scheduler, const char* app, const char* name, int size, int iterations,
+                 const Report& report){
+
+    report(report_run<int>(scheduler, app, name, size, iterations), sizeof(int), std::is_integral<int>::value);
+    report(report_run<int64_t>(scheduler, app, name, size, iterations), sizeof(int64_t), std::is_integral<int64_t>::value);
+    report(report_run<float>(scheduler, app, name, size, iterations), sizeof(float), std::is_integral<float>::value);
+    report(report_run<double>(scheduler, app, name, size, iterations), sizeof(double), std::is_integral<double>::value);
+
+}
+
+
+//runs the expressions of the fused benchmarks both as separate passes through temporary
+//arrays and as single fused passes, and prints the speedups of fusing them
+template<typename T>
+void report_fusion(WSDS::Scheduler* scheduler, int size, int iterations){
+
+    double unfused = report_run<T>(scheduler, "parallelUnfused", "Parallel (a + b) * c, unfused", size, iterations);
+    double fused = report_run<T>(scheduler, "parallelFused", "Parallel (a + b) * c, fused", size, iterations);
+    std::cout << "Fusion speedup: " << unfused / fused << std::endl << std::endl;
+
+    unfused = report_run<T>(scheduler, "parallelDotUnfused", "Parallel Dot Product, unfused", size, iterations);
+    fused = report_run<T>(scheduler, "parallelDot", "Parallel Dot Product, fused", size, iterations);
+    std::cout << "Fusion speedup: " << unfused / fused << std::endl << std::endl;
+
+}
+
+
 int main(int argc, char* argv[]){
 
     // check correct number of args
-    if (argc != 5) {
-        std::cout << "Usage: ./benchmark <task_work_size> <data_size> <iterations> <policy>" << std::endl;
+    if (argc != 5 && argc != 6) {
+        std::cout << "Usage: ./benchmark <task_work_size> <data_size> <iterations> <policy> [benchmark]" << std::endl;
         return 0;
     }
 
@@ -228,6 +617,7 @@ int main(int argc, char* argv[]){
     int datasize = 1<<atoi(argv[2]);
     int iterations = atoi(argv[3]);
     char* policy = argv[4];
+    const char* only = (argc == 6) ? argv[5] : NULL; //run just this one
     WSDS::Scheduler* scheduler;
 
     //configure scheduler based on command line input
@@ -253,30 +643,84 @@ int main(int argc, char* argv[]){
     BENCHMARKS::parallelMatrixInit(scheduler, task_work_size);
 
 
-    std::cout << "Running Parallel Add: ";
-    runtime = do_timed_run("parallelAdd", datasize, iterations);
-    std::cout << "Result: " << runtime << " us" << std::endl << std::endl;
+    //every benchmark runs on arrays of int, int64_t, float and double in turn
+    auto runtimeOnly = [](double runtime, size_t elementSize, bool integral){};
 
-    std::cout << "Running Parallel Multiply:" << std::endl;
-    runtime = do_timed_run("parallelMultiply", datasize, iterations);
-    std::cout << "Result: " << runtime << " us" << std::endl << std::endl;
+    if (only == NULL || !strcmp(only, "parallelAdd")) {
+        sweep_types(scheduler, "parallelAdd", "Parallel Add", datasize, iterations, runtimeOnly);
+    }
 
-    std::cout << "Running Parallel Copy:" << std::endl;
-    runtime = do_timed_run("parallelCopy", datasize, iterations);
-    std::cout << "Result: " << runtime << " us" << std::endl << std::endl;
+    if (only == NULL || !strcmp(only, "parallelMultiply")) {
+        sweep_types(scheduler, "parallelMultiply", "Parallel Multiply", datasize, iterations, runtimeOnly);
+    }
 
-    std::cout << "Running Parallel Reduce:" << std::endl;
-    runtime = do_timed_run("parallelReduce", datasize, iterations);
-    std::cout << "Result: " << runtime << " us" << std::endl << std::endl;
+    if (only == NULL || !strcmp(only, "parallelCopy")) {
+        //every element is read once and written once
+        sweep_types(scheduler, "parallelCopy", "Parallel Copy", datasize, iterations,
+                    [&](double runtime, size_t elementSize, bool integral){
+            std::cout << "Bandwidth: " << 2.0 * datasize * elementSize / runtime / 1e3 << " GB/s" << std::endl << std::endl;
+        });
+    }
 
-    std::cout << "Running Parallel Transpose:" << std::endl;
-    runtime = do_timed_run("parallelTranspose", datasize, iterations);
-    std::cout << "Result: " << runtime << " us" << std::endl << std::endl;
+    if (only == NULL || !strcmp(only, "simdKernels")) {
+        report_kernels(datasize, iterations);
+    }
+
+    if (only == NULL || !strcmp(only, "parallelReduce")) {
+        //the legacy reduce only exists for int
+        runtime = report_run<int>(scheduler, "parallelReduce", "Parallel Reduce", datasize, iterations);
+        double legacy = report_run<int>(scheduler, "parallelReduceLegacy", "Parallel Reduce (legacy)", datasize, iterations);
+        std::cout << "Reduce speedup over legacy: " << legacy / runtime << std::endl << std::endl;
 
-    std::cout << "Running Parallel Mat Multiply:" << std::endl;
-    runtime = do_timed_run("parallelMatMultiply", datasize, iterations);
-    std::cout << "Result: " << runtime << " us" << std::endl << std::endl;
+        //the tree reduction should win clearly on large arrays, but timings vary too much
+        //from machine to machine to fail the run over it
+        if (datasize >= (1<<24) && runtime >= legacy) {
+            std::cout << "Warning: the tree reduction was not faster than the legacy reduce" << std::endl << std::endl;
+        }
+
+        report_run<int64_t>(scheduler, "parallelReduce", "Parallel Reduce", datasize, iterations);
+        report_run<float>(scheduler, "parallelReduce", "Parallel Reduce", datasize, iterations);
+        report_run<double>(scheduler, "parallelReduce", "Parallel Reduce", datasize, iterations);
+    }
+
+    if (only == NULL || !strcmp(only, "parallelScan")) {
+        //the prefix sums of large int arrays overflow an int, so those are left out
+        if (scan_fits<int>(datasize)) {
+            report_run<int>(scheduler, "parallelScan", "Parallel Scan", datasize, iterations);
+        } else {
+            std::cout << "Skipping Parallel Scan (int), its sums overflow an int at this size" << std::endl << std::endl;
+        }
+        report_run<int64_t>(scheduler, "parallelScan", "Parallel Scan", datasize, iterations);
+        report_run<float>(scheduler, "parallelScan", "Parallel Scan", datasize, iterations);
+        report_run<double>(scheduler, "parallelScan", "Parallel Scan", datasize, iterations);
+    }
+
+    if (only == NULL || !strcmp(only, "parallelFused")) {
+        report_fusion<int>(scheduler, datasize, iterations);
+        report_fusion<int64_t>(scheduler, datasize, iterations);
+        report_fusion<float>(scheduler, datasize, iterations);
+        report_fusion<double>(scheduler, datasize, iterations);
+    }
+
+    if (only == NULL || !strcmp(only, "parallelTranspose")) {
+        //every element is read once and written once, like a copy of size^2 elements
+        auto bandwidth = [&](double runtime, size_t elementSize, bool integral){
+            std::cout << "Bandwidth: " << 2.0 * datasize * datasize * elementSize / runtime / 1e3 << " GB/s" << std::endl << std::endl;
+        };
+
+        sweep_types(scheduler, "parallelTranspose", "Parallel Transpose (in place)", datasize, iterations, bandwidth);
+        sweep_types(scheduler, "parallelTransposeOut", "Parallel Transpose (out of place)", datasize, iterations, bandwidth);
+    }
+
+    if (only == NULL || !strcmp(only, "parallelMatMultiply")) {
+        //a multiply of two n x n matrices takes 2n^3 operations, integer ones for int types
+        sweep_types(scheduler, "parallelMatMultiply", "Parallel Mat Multiply", datasize, iterations,
+                    [&](double runtime, size_t elementSize, bool integral){
+            std::cout << (integral ? "GOP/s: " : "GFLOP/s: ") << 2.0 * datasize * datasize * datasize / runtime / 1e3 << std::endl << std::endl;
+        });
+    }
 
+    delete scheduler;
 
     return 0;
 
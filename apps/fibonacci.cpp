@@ -26,18 +26,18 @@ public:
 
         // if here, spawn a task for fib(n-1) and fib(n-2)
         long x;
-        WSDS::Task* task1 = new FibTask(n-1, &x);
+        WSDS::Task* task1 = WSDS::Task::create<FibTask>(n-1, &x);
         spawn(task1);
 
         long y;
-        WSDS::Task* task2 = new FibTask(n-2, &y);
+        WSDS::Task* task2 = WSDS::Task::create<FibTask>(n-2, &y);
         spawn(task2);
 
         // wait for all spawned child tasks to finish
         wait();
 
-        delete task1;
-        delete task2;
+        WSDS::Task::recycle(task1);
+        WSDS::Task::recycle(task2);
 
         // fib(n) = fib(n-1) + fib(n-2)
         *out = x + y;
@@ -59,13 +59,13 @@ int main(int argc, char* argv[]) {
 
     int in = std::strtol(argv[1], nullptr, 10);
     long out;
-    FibTask* task = new FibTask(in, &out);
+    FibTask* task = WSDS::Task::create<FibTask>(in, &out);
 
     scheduler->spawn(task);
     scheduler->wait();
 
     std::cout << out << std::endl;
 
-    delete task;
+    WSDS::Task::recycle(task);
     delete scheduler;
 }
@@ -0,0 +1,458 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#include <iostream>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "scheduler.h"
+#include "taskgroup.h"
+
+#define NWORKERS 16
+
+class NopTask : public WSDS::Task {
+
+public:
+    void execute() {}
+
+};
+
+/*
+ * Same as the fibonacci app's task, but can allocate its children either
+ * with plain new/delete or from the worker arenas.
+ */
+template<bool useArena>
+class FibTask : public WSDS::Task {
+
+public:
+    FibTask(int n, long* out) {
+        this->n = n;
+        this->out = out;
+    }
+
+    void execute() {
+        // fib(1) and fib(2) are both 1
+        if (n <= 2) {
+            *out = 1;
+            return;
+        }
+
+        // if here, spawn a task for fib(n-1) and fib(n-2)
+        long x;
+        WSDS::Task* task1 = make(n-1, &x);
+        spawn(task1);
+
+        long y;
+        WSDS::Task* task2 = make(n-2, &y);
+        spawn(task2);
+
+        // wait for all spawned child tasks to finish
+        wait();
+
+        unmake(task1);
+        unmake(task2);
+
+        // fib(n) = fib(n-1) + fib(n-2)
+        *out = x + y;
+    }
+
+    static FibTask* make(int n, long* out) {
+        if (useArena) {
+            return WSDS::Task::create<FibTask>(n, out);
+        }
+        return new FibTask(n, out);
+    }
+
+    static void unmake(WSDS::Task* task) {
+        if (useArena) {
+            WSDS::Task::recycle(task);
+        }
+        else {
+            delete task;
+        }
+    }
+
+private:
+    int n;
+    long* out;
+
+};
+
+/*
+ * Root of a flat spawn pattern, like parallelAdd run from inside a task:
+ * spawns all of its children at once, each doing a little work.
+ */
+class FlatTask : public WSDS::Task {
+
+public:
+    FlatTask(int ntasks, int work, long* out) {
+        this->ntasks = ntasks;
+        this->work = work;
+        this->out = out;
+    }
+
+    void execute() {
+        if (this->ntasks == 0) {
+            // leaf, just burn some cycles
+            long sum = 0;
+            for (int i = 0; i < this->work; i++) {
+                sum += i ^ (sum >> 3);
+            }
+            *this->out = sum;
+            return;
+        }
+
+        std::vector<long> sums(this->ntasks);
+        std::vector<WSDS::Task*> tasks(this->ntasks);
+        for (int i = 0; i < this->ntasks; i++) {
+            tasks[i] = WSDS::Task::create<FlatTask>(0, this->work, &sums[i]);
+            spawn(tasks[i]);
+        }
+
+        wait();
+
+        *this->out = 0;
+        for (int i = 0; i < this->ntasks; i++) {
+            *this->out += sums[i];
+            WSDS::Task::recycle(tasks[i]);
+        }
+    }
+
+private:
+    int ntasks;
+    int work;
+    long* out;
+
+};
+
+/*
+ * Records when it started executing, to measure how long it takes a
+ * parked worker to wake up and pick up new work.
+ */
+class StampTask : public WSDS::Task {
+
+public:
+    void execute() {
+        gettimeofday(&this->started, NULL);
+    }
+
+    struct timeval started;
+
+};
+
+double t2d(struct timeval *t) {
+    return t->tv_sec*1000000.0 + t->tv_usec;
+}
+
+/************************************************************/
+/*                 Spawn + Pop                              */
+/************************************************************/
+
+/*
+ * Spawns a child task and joins it again, over and over, so every round goes
+ * through the worker's real spawn path, Worker::add_ready_task(), and its
+ * real local pop, Worker::pop_ready_task() in the wait loop.
+ */
+class SpawnPopTask : public WSDS::Task {
+
+public:
+    SpawnPopTask(int ops) {
+        this->ops = ops;
+    }
+
+    void execute() {
+        for (int i = 0; i < this->ops; i++) {
+            WSDS::Task* child = WSDS::Task::create<NopTask>();
+            spawn(child);
+            wait();
+            WSDS::Task::recycle(child);
+        }
+    }
+
+private:
+    int ops;
+
+};
+
+// returns spawn+pop pairs per second of a root task on a fresh scheduler,
+// in millions
+double do_spawn_pop_run(int nworkers, int workerAlg, int ops) {
+    struct timeval before, after;
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(nworkers, workerAlg);
+    SpawnPopTask task(ops);
+
+    gettimeofday(&before, NULL);
+    scheduler->spawn(&task);
+    scheduler->wait();
+    gettimeofday(&after, NULL);
+
+    delete scheduler;
+
+    return ops / (t2d(&after) - t2d(&before));
+}
+
+// the lock-free owner path of work stealing against the per-worker mutex of
+// the other policies, first on a lone worker, then with more and more other
+// workers stealing or being handed the children
+void spawn_pop(int maxworkers, int ops) {
+    std::cout << "workers\tstealing (Mops/s)\tround robin (Mops/s)" << std::endl;
+    for (int nworkers = 1; nworkers <= maxworkers; nworkers *= 2) {
+        double stealing = do_spawn_pop_run(nworkers, WSDS::WORK_STEALING, ops);
+        double roundRobin = do_spawn_pop_run(nworkers, WSDS::ROUND_ROBIN, ops);
+        std::cout << nworkers << "\t" << stealing << "\t\t\t" << roundRobin << std::endl;
+    }
+}
+
+/************************************************************/
+/*                 Fibonacci Scaling                        */
+/************************************************************/
+
+// returns the runtime of fib(n) in us on a fresh scheduler
+template<bool useArena>
+double do_fib_run(int nworkers, int n, int pinning = WSDS::NO_PINNING, double* stealCost = nullptr) {
+    struct timeval before, after;
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(nworkers, WSDS::WORK_STEALING, pinning);
+
+    long out;
+    FibTask<useArena>* task = FibTask<useArena>::make(n, &out);
+
+    gettimeofday(&before, NULL);
+    scheduler->spawn(task);
+    scheduler->wait();
+    gettimeofday(&after, NULL);
+
+    // victims probed per successful steal
+    if (stealCost != nullptr) {
+        WSDS::Stats stats = scheduler->stats();
+        *stealCost = (stats.steals > 0) ? (double)stats.stealAttempts / stats.steals : 0;
+    }
+
+    FibTask<useArena>::unmake(task);
+    delete scheduler;
+
+    return t2d(&after) - t2d(&before);
+}
+
+void fib_scale(int maxworkers, int n, int pinning) {
+    std::cout << "cache line size: " << WSDS::internal::CACHE_LINE_SIZE << " bytes" << std::endl;
+    std::cout << "workers\ttime (us)\tspeedup\tattempts/steal" << std::endl;
+    double base = 0;
+    for (int nworkers = 1; nworkers <= maxworkers; nworkers++) {
+        double stealCost;
+        double time = do_fib_run<true>(nworkers, n, pinning, &stealCost);
+        if (nworkers == 1) {
+            base = time;
+        }
+        std::cout << nworkers << "\t" << time << "\t" << base / time << "\t" << stealCost << std::endl;
+    }
+}
+
+/************************************************************/
+/*                 Fibonacci Task Allocation                */
+/************************************************************/
+
+void fib_alloc(int nworkers, int n, int iterations) {
+    double heap = 0;
+    double arena = 0;
+    for (int i = 0; i < iterations; i++) {
+        heap += do_fib_run<false>(nworkers, n);
+        arena += do_fib_run<true>(nworkers, n);
+    }
+
+    std::cout << "new/delete: " << heap / iterations << " us" << std::endl;
+    std::cout << "task arena: " << arena / iterations << " us" << std::endl;
+    std::cout << "speedup:    " << heap / arena << std::endl;
+}
+
+/************************************************************/
+/*                 Fibonacci Lambdas                        */
+/************************************************************/
+
+// fib(n) spawning its two halves as lambdas instead of FibTasks
+long fib_lambda(int n) {
+    if (n <= 2) {
+        return 1;
+    }
+
+    long x, y;
+    WSDS::TaskGroup group;
+    group.spawn([&] { x = fib_lambda(n-1); });
+    group.spawn([&] { y = fib_lambda(n-2); });
+    group.sync();
+
+    return x + y;
+}
+
+// returns the runtime of the lambda fib(n) in us on a fresh scheduler
+double do_fib_lambda_run(int nworkers, int n) {
+    struct timeval before, after;
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(nworkers);
+
+    long out;
+
+    gettimeofday(&before, NULL);
+    scheduler->spawn([&] { out = fib_lambda(n); });
+    scheduler->wait();
+    gettimeofday(&after, NULL);
+
+    delete scheduler;
+
+    return t2d(&after) - t2d(&before);
+}
+
+void fib_lambda(int nworkers, int n, int iterations) {
+    double subclass = 0;
+    double lambda = 0;
+    for (int i = 0; i < iterations; i++) {
+        subclass += do_fib_run<true>(nworkers, n);
+        lambda += do_fib_lambda_run(nworkers, n);
+    }
+
+    std::cout << "task subclass: " << subclass / iterations << " us" << std::endl;
+    std::cout << "lambda:        " << lambda / iterations << " us" << std::endl;
+    std::cout << "speedup:       " << subclass / lambda << std::endl;
+}
+
+/************************************************************/
+/*                 Flat Spawn                               */
+/************************************************************/
+
+void flat_spawn(int nworkers, int ntasks, int work, int iterations) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(nworkers);
+    struct timeval before, after;
+    double time = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        long out;
+        FlatTask* task = new FlatTask(ntasks, work, &out);
+
+        gettimeofday(&before, NULL);
+        scheduler->spawn(task);
+        scheduler->wait();
+        gettimeofday(&after, NULL);
+        time += t2d(&after) - t2d(&before);
+
+        delete task;
+    }
+
+    delete scheduler;
+
+    std::cout << "max steal batch: " << WSDS::internal::MAX_STEAL_BATCH << " tasks" << std::endl;
+    std::cout << "time:            " << time / iterations << " us" << std::endl;
+    std::cout << "per task:        " << 1000 * time / iterations / ntasks << " ns" << std::endl;
+}
+
+/************************************************************/
+/*                 Idle Workers                             */
+/************************************************************/
+
+// user + system CPU time used by the whole process so far, in us
+double cpu_time() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return t2d(&usage.ru_utime) + t2d(&usage.ru_stime);
+}
+
+void idle(int nworkers, int ms, int wakeups) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(nworkers);
+
+    // give the workers time to run out of spins and park
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    struct timeval before, after;
+    gettimeofday(&before, NULL);
+    double cpuBefore = cpu_time();
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    double cpuAfter = cpu_time();
+    gettimeofday(&after, NULL);
+
+    // fraction of one core the idle scheduler kept busy
+    double usage = 100.0 * (cpuAfter - cpuBefore) / (t2d(&after) - t2d(&before));
+
+    // time from spawning a task onto a parked scheduler until it runs
+    double latency = 0;
+    for (int i = 0; i < wakeups; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        StampTask* task = WSDS::Task::create<StampTask>();
+        gettimeofday(&before, NULL);
+        scheduler->spawn(task);
+        scheduler->wait();
+        latency += t2d(&task->started) - t2d(&before);
+        WSDS::Task::recycle(task);
+    }
+
+    delete scheduler;
+
+    std::cout << "workers:      " << nworkers << std::endl;
+    std::cout << "idle cpu:     " << usage << " % of one core" << std::endl;
+    std::cout << "wake latency: " << latency / wakeups << " us" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+
+    // check correct number of args
+    if (argc < 2) {
+        std::cout << "Usage: ./microbench <mode> [args]" << std::endl;
+        std::cout << "  spawnpop <log2_ops> [max_workers]" << std::endl;
+        std::cout << "  fibscale <index> [max_workers] [none|compact|scatter]" << std::endl;
+        std::cout << "  fiballoc <index> [workers] [iterations]" << std::endl;
+        std::cout << "  fiblambda <index> [workers] [iterations]" << std::endl;
+        std::cout << "  flatspawn <log2_tasks> [workers] [work] [iterations]" << std::endl;
+        std::cout << "  idle <milliseconds> [workers] [wakeups]" << std::endl;
+        return 0;
+    }
+
+    char* mode = argv[1];
+
+    if (!strcmp(mode, "spawnpop") && argc >= 3) {
+        int ops = 1<<atoi(argv[2]);
+        int maxworkers = (argc >= 4) ? atoi(argv[3]) : NWORKERS;
+        spawn_pop(maxworkers, ops);
+    } else if (!strcmp(mode, "fibscale") && argc >= 3) {
+        int n = atoi(argv[2]);
+        int maxworkers = (argc >= 4) ? atoi(argv[3]) : NWORKERS;
+        int pinning = WSDS::NO_PINNING;
+        if (argc >= 5 && !strcmp(argv[4], "compact")) {
+            pinning = WSDS::PIN_COMPACT;
+        } else if (argc >= 5 && !strcmp(argv[4], "scatter")) {
+            pinning = WSDS::PIN_SCATTER;
+        }
+        fib_scale(maxworkers, n, pinning);
+    } else if (!strcmp(mode, "fiballoc") && argc >= 3) {
+        int n = atoi(argv[2]);
+        int nworkers = (argc >= 4) ? atoi(argv[3]) : NWORKERS;
+        int iterations = (argc >= 5) ? atoi(argv[4]) : 1;
+        fib_alloc(nworkers, n, iterations);
+    } else if (!strcmp(mode, "fiblambda") && argc >= 3) {
+        int n = atoi(argv[2]);
+        int nworkers = (argc >= 4) ? atoi(argv[3]) : NWORKERS;
+        int iterations = (argc >= 5) ? atoi(argv[4]) : 1;
+        fib_lambda(nworkers, n, iterations);
+    } else if (!strcmp(mode, "flatspawn") && argc >= 3) {
+        int ntasks = 1<<atoi(argv[2]);
+        int nworkers = (argc >= 4) ? atoi(argv[3]) : NWORKERS;
+        int work = (argc >= 5) ? atoi(argv[4]) : 100;
+        int iterations = (argc >= 6) ? atoi(argv[5]) : 10;
+        flat_spawn(nworkers, ntasks, work, iterations);
+    } else if (!strcmp(mode, "idle") && argc >= 3) {
+        int ms = atoi(argv[2]);
+        int nworkers = (argc >= 4) ? atoi(argv[3]) : NWORKERS;
+        int wakeups = (argc >= 5) ? atoi(argv[4]) : 100;
+        idle(nworkers, ms, wakeups);
+    } else {
+
+        std::cout << "Error: Unknown or incomplete microbenchmark mode." << std::endl;
+        std::cout << " Please use one of the following: spawnpop | fibscale | fiballoc | fiblambda | flatspawn | idle" << std::endl;
+        exit(-1);
+
+    }
+
+    return 0;
+
+}
@@ -3,8 +3,8 @@
  */
 
 #include "parallelArray.h"
+#include "parallel.h"
 #include "math.h"
-#include <iostream>
 
 
 namespace BENCHMARKS {
@@ -12,42 +12,6 @@ namespace BENCHMARKS {
     WSDS::Scheduler* parSched;
     int work_per_subtask;
 
-    void print_arr(int* arr, int size){
-
-        for (int i = 0; i < size; i ++){
-
-            std::cout << arr[i] << " ";
-
-        }
-
-        std::cout << std::endl;
-
-
-    }
-
-    //if parenttask is NULL default to sheduler spawning.  If non-null, the user wants
-    //task to be tracked as a subtask of a pre-existing task
-    void Spawn(WSDS::Task* newTask, WSDS::Task* parentTask){
-
-        if (parentTask == NULL){
-            parSched->spawn(newTask);
-        } else {
-            parentTask->spawn(newTask);
-        }
-
-    }
-
-    void Wait(WSDS::Task* parentTask){
-
-        if (parentTask == NULL){
-            parSched->wait();
-        } else {
-            parentTask->wait();
-        }
-
-    }
-
-
     /****************************************************************/
     /*            Library Init                                      */
     /****************************************************************/
@@ -56,213 +20,40 @@ namespace BENCHMARKS {
         work_per_subtask = task_work_size;
     }
 
-    /****************************************************************/
-    /*            Parallel Adding                                   */
-    /****************************************************************/
-    void parallelAdd(int* vecOut, int* vecA, int* vecB, int size, WSDS::Task* parentTask) {
-
-
-        int num_sub_tasks = size / work_per_subtask;
-        int partial_size = size  / num_sub_tasks;
-        int i;
-
-        ParallelAddTaskPartial* tasks[num_sub_tasks];
-
-
-        /*Spawn a bunch of congruent work to divide up array to do vector adds*/
-        for (i = 0; i < num_sub_tasks; i++){
-
-            int offset = i*partial_size;
-
-            tasks[i] = new ParallelAddTaskPartial(&vecOut[offset], &vecA[offset], &vecB[offset], partial_size);
-
-            Spawn(tasks[i], parentTask);
-
-        }
-
-        /*wait until all child tasks are done*/
-        Wait(parentTask);
-
-        /*clean up the sub tasks*/
-        for (i = 0; i < num_sub_tasks; i++){
-            delete tasks[i];
-        }
-
-    }
-
-
-    ParallelAddTaskPartial::ParallelAddTaskPartial(int* vecOut, int* vecA, int* vecB, int size) {
-        this->vecA = vecA;
-        this->vecB = vecB;
-        this->vecOut = vecOut;
-        this->size = size;
-    }
-
-    void ParallelAddTaskPartial::execute(){
-
-        for(int i = 0; i < this->size; i++) {
-            vecOut[i] = vecA[i] + vecB[i];
-        }
-
-    }
-
-    /****************************************************************/
-    /*            Parallel Mutliply                                 */
-    /****************************************************************/
-    void parallelMultiply(int* vecOut, int* vecA, int* vecB, int size, WSDS::Task* parentTask) {
-
-        int i;
-        int num_sub_tasks = size / work_per_subtask;
-        int partial_size = size  / num_sub_tasks;
-
-        ParallelMultiplyTaskPartial* tasks[num_sub_tasks];
-
-        /*Spawn a bunch of congruent work to divide up array to do vector adds*/
-        for (i = 0; i < num_sub_tasks; i++){
-
-            int offset = i*partial_size;
-
-            tasks[i] = new ParallelMultiplyTaskPartial(&vecOut[offset], &vecA[offset], &vecB[offset], partial_size);
-
-            Spawn(tasks[i], parentTask);
-
-        }
-
-        /*wait until all child tasks are done*/
-        Wait(parentTask);
-
-        /*clean up the sub tasks*/
-        for (i = 0; i < num_sub_tasks; i++){
-            delete tasks[i];
-        }
-
-    }
-
-
-    ParallelMultiplyTaskPartial::ParallelMultiplyTaskPartial(int* vecOut, int* vecA, int* vecB, int size) {
-        this->vecA = vecA;
-        this->vecB = vecB;
-        this->vecOut = vecOut;
-        this->size = size;
-    }
-
-    void ParallelMultiplyTaskPartial::execute(){
-
-        for(int i = 0; i < this->size; i++) {
-            vecOut[i] = vecA[i] * vecB[i];
-        }
-
-    }
-
-
-    /****************************************************************/
-    /*            Parallel Copying                                  */
-    /****************************************************************/
-
-    void parallelCopy(int* out, int* in, int size, WSDS::Task* parentTask){
-
-        int i;
-        int num_sub_tasks = size / work_per_subtask;
-        int partial_size = size  / num_sub_tasks;
-
-        ParallelCopyTaskPartial* tasks[num_sub_tasks];
-
-
-        /*Spawn a bunch of congruent work to divide up array to do vector adds*/
-        for (i = 0; i < num_sub_tasks; i++){
-
-            int offset = i*partial_size;
-
-            tasks[i] = new ParallelCopyTaskPartial(&out[offset], &in[offset], partial_size);
-
-            Spawn(tasks[i], parentTask);
-
-        }
-
-        /*wait until all child tasks are done*/
-        Wait(parentTask);
-
-        /*clean up the sub tasks*/
-        for (i = 0; i < num_sub_tasks; i++){
-            delete tasks[i];
-        }
-
-
-
-    }
-
-
-    ParallelCopyTaskPartial::ParallelCopyTaskPartial(int* vecOut, int* vecIn, int size){
-
-        this->vecOut = vecOut;
-        this->vecIn = vecIn;
-        this->size = size;
-
-    }
-
-    void ParallelCopyTaskPartial::execute(){
-        for (int i = 0; i < this->size; i++){
-            this->vecOut[i] = this->vecIn[i];
-        }
-
-    }
-
-
     /****************************************************************/
     /*            Parallel Reduce                                   */
     /****************************************************************/
 
+    int parallelReduceLegacy(int* in, int size){
 
-    int parallelReduce(int* in, int size, WSDS::Task* parentTask){
-
-        int arrIn[size];
-        int out[size];
+        //too large for the stack with big arrays
+        int* arrIn = new int[size];
+        int* out = new int[size];
 
-        parallelCopy(arrIn, in, size, parentTask);
+        parallelCopy(arrIn, in, size);
 
         int num_steps = (int)log2((double)size);
-        int num_sub_tasks = size / work_per_subtask;
-
-        ParallelReduceTaskPartial* tasks[size];
 
         for ( int step = 1; step <= num_steps; step++){
 
-            for (int task = 0; task < num_sub_tasks; task++){
-
-                tasks[task] = new ParallelReduceTaskPartial(out, arrIn, task*work_per_subtask+1, size, step);
-
-                Spawn(tasks[task], parentTask);
+            //pairwise sums of the previous step, out[i-1] for i <= N/2^h
+            WSDS::parallel_for(1, size / (1<<step) + 1, work_per_subtask, [=](int begin, int end) {
+                for (int i = begin; i < end; i++) {
+                    out[i-1] = arrIn[2*i-2] + arrIn[2*i-1];
+                }
+            }, parSched);
 
-            }
-
-            Wait(parentTask);
 	    //need to transport array back to in.  This is to workaround not having barriers in our task library
-            parallelCopy(arrIn, out, size, parentTask);
+            parallelCopy(arrIn, out, size);
 
         }
-        return out[0];
-
-    }
 
-    ParallelReduceTaskPartial::ParallelReduceTaskPartial(int* arrOut, int* arrIn, int start_idx, int size, int step){
-        this->arrOut = arrOut;
-        this->arrIn = arrIn;
-        this->size = size;
-        this->step = step;
-        this->start_idx = start_idx;
-    }
+        int result = arrIn[0];
 
+        delete[] arrIn;
+        delete[] out;
 
-    void ParallelReduceTaskPartial::execute(){
-        if (start_idx > ( size / (1<<step))) {
-            return; //nothing to do
-        }
-
-        for (int i = start_idx; i <= start_idx + work_per_subtask; i++){
-            if (i <= ( size / (1<<step) ) ) { //i <= N/2^h
-                arrOut[i-1] = arrIn[2*i-2] + arrIn[2*i-1];
-            }
-        }
+        return result;
 
     }
 
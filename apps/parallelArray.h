@@ -5,11 +5,33 @@
 #ifndef _VECTOR_ADD_TASK_DEFINE
 #define _VECTOR_ADD_TASK_DEFINE
 
+#include <functional>
+#include <stdint.h>
+#include <type_traits>
 #include "task.h"
 #include "scheduler.h"
+#include "parallel.h"
+#include "simdKernels.h"
 
 namespace BENCHMARKS {
 
+    /*
+     * All functions split their arrays with WSDS::parallel_for(), into pieces
+     * of at most task_work_size elements. Called from inside a task they run
+     * as children of that task, otherwise as root tasks of the scheduler
+     * registered with parallelArrayInit().
+     *
+     * The functions are templates over the element type, and the operator
+     * where there is one, so every element type and operator gets inner loops
+     * of its own, with the operator inlined, which the compiler can vectorize.
+     * Adding, multiplying and copying run the hand-written kernels of
+     * simdKernels.h on every piece instead, where there are any for the type.
+     */
+
+    //scheduler and task work size registered by parallelArrayInit()
+    extern WSDS::Scheduler* parSched;
+    extern int work_per_subtask;
+
 
     /****************************************************************/
     /*            Library Init                                      */
@@ -18,97 +40,107 @@ namespace BENCHMARKS {
 
 
     /****************************************************************/
-    /*            Parallel Adding                                   */
+    /*            Parallel Element-wise Operations                  */
     /****************************************************************/
-    void parallelAdd(int* vecOut, int* vecA, int* vecB, int size, WSDS::Task* parentTask = NULL);
-
-    class ParallelAddTaskPartial : public WSDS::Task {
-
 
-    public:
+    //vecOut[i] = op(vecA[i], vecB[i])
+    template<typename T, typename Op>
+    void parallelApply(T* vecOut, const T* vecA, const T* vecB, long size, Op op) {
 
-        ParallelAddTaskPartial(int* vecOut, int* vecA, int* vecB, int size);
+        WSDS::parallel_for(0L, size, (long)work_per_subtask, [=](long begin, long end) {
+            for (long i = begin; i < end; i++) {
+                vecOut[i] = op(vecA[i], vecB[i]);
+            }
+        }, parSched);
 
-        void execute();
+    }
 
-    private:
 
-        int* vecA;
-        int* vecB;
-        int* vecOut;
-        int size;
-
-    };
     /****************************************************************/
-    /*            Parallel Multiplying                              */
+    /*            Parallel Adding                                   */
     /****************************************************************/
-    void parallelMultiply(int* vecOut, int* vecA, int* vecB, int size, WSDS::Task* parentTask = NULL);
+    template<typename T>
+    void parallelAdd(T* vecOut, const T* vecA, const T* vecB, long size) {
 
-    class ParallelMultiplyTaskPartial : public WSDS::Task {
+        WSDS::parallel_for(0L, size, (long)work_per_subtask, [=](long begin, long end) {
+            simdAdd(vecOut + begin, vecA + begin, vecB + begin, end - begin);
+        }, parSched);
 
+    }
 
-    public:
 
-        ParallelMultiplyTaskPartial(int* vecOut, int* vecA, int* vecB, int size);
-
-        void execute();
+    /****************************************************************/
+    /*            Parallel Multiplying                              */
+    /****************************************************************/
+    template<typename T>
+    void parallelMultiply(T* vecOut, const T* vecA, const T* vecB, long size) {
 
-    private:
+        WSDS::parallel_for(0L, size, (long)work_per_subtask, [=](long begin, long end) {
+            simdMultiply(vecOut + begin, vecA + begin, vecB + begin, end - begin);
+        }, parSched);
 
-        int* vecA;
-        int* vecB;
-        int* vecOut;
-        int size;
+    }
 
-    };
 
     /****************************************************************/
     /*            Parallel Copying                                  */
     /****************************************************************/
+    //copies too big for the cache are streamed past it, rather than evicting everything
+    //else just to be evicted again themselves
+    template<typename T>
+    void parallelCopy(T* out, const T* in, long size) {
 
-    void parallelCopy(int* out, int* in, int size, WSDS::Task* parentTask = NULL);
-
-    class ParallelCopyTaskPartial : public WSDS::Task {
-
-
-    public:
+        bool stream = size * (long)sizeof(T) >= streamingThreshold();
 
-        ParallelCopyTaskPartial(int* vecOut, int* vecIn, int size);
+        WSDS::parallel_for(0L, size, (long)work_per_subtask, [=](long begin, long end) {
+            simdCopy(out + begin, in + begin, end - begin, stream);
+        }, parSched);
 
-        void execute();
-
-    private:
-
-        int* vecOut;
-        int* vecIn;
-        int size;
-    };
+    }
 
 
     /****************************************************************/
     /*            Parallel Reduce                                   */
     /****************************************************************/
 
-    int parallelReduce(int* in, int size,  WSDS::Task* parentTask = NULL);
+    //type sums are accumulated in, integers are summed up as 64 bits so
+    //large arrays do not overflow
+    template<typename T>
+    using SumType = typename std::conditional<std::is_integral<T>::value, int64_t, T>::type;
+
+    //reduces the array with op, starting from identity, as a tree over per-task
+    //partial results, by default sums up the array
+    template<typename T, typename Acc = SumType<T>, typename Op = std::plus<Acc>>
+    Acc parallelReduce(const T* in, long size, Op op = Op(), Acc identity = Acc()) {
 
+        return WSDS::parallel_reduce(0L, size, (long)work_per_subtask, identity, [=](long begin, long end) {
+            Acc partial = identity;
+            for (long i = begin; i < end; i++) {
+                partial = op(partial, (Acc)in[i]);
+            }
+            return partial;
+        }, op, parSched);
 
-    class ParallelReduceTaskPartial : public WSDS::Task {
+    }
 
+    //sums up the array in log2(size) rounds of pairwise sums, each followed
+    //by a full copy of the array, kept for comparison with parallelReduce
+    int parallelReduceLegacy(int* in, int size);
 
-    public:
 
-        ParallelReduceTaskPartial(int* arrOut, int* arrIn, int start_idx, int size, int step);
+    /****************************************************************/
+    /*            Parallel Scan                                     */
+    /****************************************************************/
 
-        void execute();
+    //prefix sums, out[i] = in[0] + ... + in[i], or up to in[i-1] if exclusive,
+    //or the same with another associative op and its identity
+    template<typename T, typename Op = std::plus<T>>
+    void parallelScan(T* out, const T* in, long size, bool exclusive = false, Op op = Op(), T identity = T()) {
 
-    private:
+        WSDS::parallel_scan(in, out, size, (long)work_per_subtask, identity, op,
+                            exclusive ? WSDS::EXCLUSIVE_SCAN : WSDS::INCLUSIVE_SCAN, parSched);
 
-        int* arrOut;
-        int* arrIn;
-        int size;
-        int step;
-        int start_idx;
-    };
+    }
 
 
 }
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#ifndef _PARALLEL_EXPR_DEFINE
+#define _PARALLEL_EXPR_DEFINE
+
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include "parallelArray.h"
+
+namespace BENCHMARKS {
+
+    /*
+     * Lazy element-wise expressions over arrays, e.g.
+     *
+     *     parallelEval(out, (expr(a) + expr(b)) * expr(c), size);
+     *     double dot = parallelReduce(expr(x) * expr(y), size);
+     *
+     * Building an expression computes nothing, its type just records the
+     * arrays and operators. parallelEval() and parallelReduce() then compute
+     * the whole expression element by element, in a single parallel_for()
+     * pass reading every input array once, where separate parallelAdd() and
+     * parallelMultiply() calls would each take a pass of their own, with
+     * temporary arrays in between.
+     *
+     * Expressions hold pointers to the arrays, not the arrays, so they stay
+     * cheap to copy into the tasks. Element i only depends on element i of
+     * every array, so out may be one of the input arrays.
+     */
+
+
+    /****************************************************************/
+    /*            Expressions                                       */
+    /****************************************************************/
+
+    //base of all expressions, Derived has a value_type and an operator[](long) computing
+    //element i
+    template<typename Derived>
+    struct Expr {
+        const Derived& self() const { return static_cast<const Derived&>(*this); }
+    };
+
+    //the elements of an array
+    template<typename T>
+    struct ArrayExpr : Expr<ArrayExpr<T>> {
+        typedef T value_type;
+
+        ArrayExpr(const T* data) : data(data) {}
+        T operator[](long i) const { return this->data[i]; }
+
+        const T* data;
+    };
+
+    //the same value for every element
+    template<typename T>
+    struct ScalarExpr : Expr<ScalarExpr<T>> {
+        typedef T value_type;
+
+        ScalarExpr(T value) : value(value) {}
+        T operator[](long i) const { return this->value; }
+
+        T value;
+    };
+
+    //op applied to the elements of an expression
+    template<typename E, typename Op>
+    struct MapExpr : Expr<MapExpr<E, Op>> {
+        typedef decltype(std::declval<Op>()(std::declval<typename E::value_type>())) value_type;
+
+        MapExpr(const E& e, Op op) : e(e), op(op) {}
+        value_type operator[](long i) const { return this->op(this->e[i]); }
+
+        E e;
+        Op op;
+    };
+
+    //op applied to the elements of two expressions
+    template<typename L, typename R, typename Op>
+    struct ZipExpr : Expr<ZipExpr<L, R, Op>> {
+        typedef decltype(std::declval<Op>()(std::declval<typename L::value_type>(),
+                                            std::declval<typename R::value_type>())) value_type;
+
+        ZipExpr(const L& lhs, const R& rhs, Op op) : lhs(lhs), rhs(rhs), op(op) {}
+        value_type operator[](long i) const { return this->op(this->lhs[i], this->rhs[i]); }
+
+        L lhs;
+        R rhs;
+        Op op;
+    };
+
+
+    //an array as an expression
+    template<typename T>
+    ArrayExpr<T> expr(const T* data) {
+        return ArrayExpr<T>(data);
+    }
+
+    //op(e[i]) for every element, op may be any callable, e.g. a lambda
+    template<typename E, typename Op>
+    MapExpr<E, Op> exprMap(const Expr<E>& e, Op op) {
+        return MapExpr<E, Op>(e.self(), op);
+    }
+
+    //op(lhs[i], rhs[i]) for every element
+    template<typename L, typename R, typename Op>
+    ZipExpr<L, R, Op> exprZip(const Expr<L>& lhs, const Expr<R>& rhs, Op op) {
+        return ZipExpr<L, R, Op>(lhs.self(), rhs.self(), op);
+    }
+
+    template<typename E>
+    MapExpr<E, std::negate<>> operator-(const Expr<E>& e) {
+        return exprMap(e, std::negate<>());
+    }
+
+    //arithmetic operators between two expressions, or an expression and a number
+#define EXPR_OPERATOR(symbol, functor)                                                      \
+    template<typename L, typename R>                                                        \
+    ZipExpr<L, R, functor> operator symbol(const Expr<L>& lhs, const Expr<R>& rhs) {        \
+        return exprZip(lhs, rhs, functor());                                                \
+    }                                                                                       \
+    template<typename L, typename S, typename = std::enable_if_t<std::is_arithmetic<S>::value>> \
+    ZipExpr<L, ScalarExpr<S>, functor> operator symbol(const Expr<L>& lhs, S rhs) {          \
+        return exprZip(lhs, ScalarExpr<S>(rhs), functor());                                 \
+    }                                                                                       \
+    template<typename S, typename R, typename = std::enable_if_t<std::is_arithmetic<S>::value>> \
+    ZipExpr<ScalarExpr<S>, R, functor> operator symbol(S lhs, const Expr<R>& rhs) {          \
+        return exprZip(ScalarExpr<S>(lhs), rhs, functor());                                 \
+    }
+
+    EXPR_OPERATOR(+, std::plus<>)
+    EXPR_OPERATOR(-, std::minus<>)
+    EXPR_OPERATOR(*, std::multiplies<>)
+    EXPR_OPERATOR(/, std::divides<>)
+
+#undef EXPR_OPERATOR
+
+
+    /****************************************************************/
+    /*            Evaluation                                        */
+    /****************************************************************/
+
+    //out[i] = e[i] for i in [0, size), in a single pass
+    template<typename T, typename E>
+    void parallelEval(T* out, const Expr<E>& e, long size) {
+
+        E expression = e.self();
+
+        WSDS::parallel_for(0L, size, (long)work_per_subtask, [=](long begin, long end) {
+            for (long i = begin; i < end; i++) {
+                out[i] = expression[i];
+            }
+        }, parSched);
+
+    }
+
+    //reduces e[0, size) with op, starting from identity, in a single pass without ever
+    //storing the elements of e, by default sums them up like parallelReduce on an array
+    template<typename E, typename Acc = SumType<typename E::value_type>, typename Op = std::plus<Acc>>
+    Acc parallelReduce(const Expr<E>& e, long size, Op op = Op(), Acc identity = Acc()) {
+
+        E expression = e.self();
+
+        return WSDS::parallel_reduce(0L, size, (long)work_per_subtask, identity, [=](long begin, long end) {
+            Acc partial = identity;
+            for (long i = begin; i < end; i++) {
+                partial = op(partial, (Acc)expression[i]);
+            }
+            return partial;
+        }, op, parSched);
+
+    }
+
+
+}
+
+#endif
@@ -1,6 +1,12 @@
 
 #include "parallelMatrix.h"
-#include "parallelArray.h"
+#include "parallel.h"
+#include "taskgroup.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <stdint.h>
+#include <type_traits>
+#include <vector>
 
 namespace BENCHMARKS {
 
@@ -16,134 +22,427 @@ namespace BENCHMARKS {
     }
 
 
-    void parallelMatrixTranspose(int* x, int size){
+    /******************************************************************/
+    /*                    Matrix Transpose                            */
+    /******************************************************************/
 
-        int i;
-        int num_blocks_x = size / work_per_subtaskm;
-        int num_blocks_y = num_blocks_x; //square matrix
-        int num_blocks_total = num_blocks_x * num_blocks_y;
+    //blocks are split down to tiles of at most TILE x TILE elements, which are moved
+    //through local buffers, so main memory is only ever walked along rows
+    static constexpr int TILE = 32;
 
-        int num_sub_tasks = num_blocks_total;
 
+    //runs f and g, in parallel if spawn is set
+    template<typename F, typename G>
+    void fork_join(bool spawn, const F& f, const G& g){
+        if (!spawn){
+            f();
+            g();
+            return;
+        }
 
-        ParallelMatrixTransposePartial* tasks[num_sub_tasks];
+        WSDS::TaskGroup group;
+        group.spawn(f);
+        g();
+        group.sync();
+    }
 
-        for (i = 0; i < num_sub_tasks; i++){
+    //are blocks of the given size worth splitting among tasks?
+    bool worth_spawning(int rows, int cols){
+        return (long)rows * cols > std::max(work_per_subtaskm, TILE * TILE);
+    }
 
-            tasks[i] = new ParallelMatrixTransposePartial(x, size, work_per_subtaskm, i);
 
-            parSchedMat->spawn(tasks[i]);
+    //copies a rows x cols tile at x into buf, row by row
+    template<typename T>
+    void load_tile(T* buf, const T* x, int size, int rows, int cols){
+        for (int i = 0; i < rows; i++){
+            std::copy(&x[GET_IDX(i, 0, size)], &x[GET_IDX(i, cols, size)], &buf[i * cols]);
         }
+    }
 
-        parSchedMat->wait();
-
-        for (i = 0; i < num_sub_tasks; i++){
-            delete tasks[i];
+    //writes the transpose of a rows x cols tile in buf to x, row by row
+    template<typename T>
+    void store_tile_transposed(T* x, const T* buf, int size, int rows, int cols){
+        for (int j = 0; j < cols; j++){
+            T* row = &x[GET_IDX(j, 0, size)];
+            for (int i = 0; i < rows; i++){
+                row[i] = buf[i * cols + j];
+            }
         }
+    }
 
 
-    }
+    //swaps the rows x cols block at (i0, j0) with the transpose of its mirror block at
+    //(j0, i0), the two blocks must not overlap
+    template<typename T>
+    void swap_transposed(T* x, int size, int i0, int j0, int rows, int cols){
 
+        if (rows <= TILE && cols <= TILE){
+            T upper[TILE * TILE];
+            T lower[TILE * TILE];
 
-    ParallelMatrixTransposePartial::ParallelMatrixTransposePartial(int* x, int size, int block_width, int block_idx){
+            load_tile(upper, &x[GET_IDX(i0, j0, size)], size, rows, cols);
+            load_tile(lower, &x[GET_IDX(j0, i0, size)], size, cols, rows);
+            store_tile_transposed(&x[GET_IDX(i0, j0, size)], lower, size, cols, rows);
+            store_tile_transposed(&x[GET_IDX(j0, i0, size)], upper, size, rows, cols);
+            return;
+        }
 
-            this->x = x;
-            this->size = size;
-            this->block_width = block_width;
-            this->block_idx = block_idx;
+        //halve the longer side
+        bool spawn = worth_spawning(rows, cols);
+        if (rows >= cols){
+            int half = rows / 2;
+            fork_join(spawn,
+                [=]{ swap_transposed(x, size, i0, j0, half, cols); },
+                [=]{ swap_transposed(x, size, i0 + half, j0, rows - half, cols); });
+        } else {
+            int half = cols / 2;
+            fork_join(spawn,
+                [=]{ swap_transposed(x, size, i0, j0, rows, half); },
+                [=]{ swap_transposed(x, size, i0, j0 + half, rows, cols - half); });
+        }
 
     }
 
+    //transposes the len x len block on the diagonal at (d0, d0) in place
+    template<typename T>
+    void transpose_diagonal(T* x, int size, int d0, int len){
+
+        if (len <= TILE){
+            for (int i = d0; i < d0 + len; i++){
+                for (int j = i + 1; j < d0 + len; j++){
+                    std::swap(x[GET_IDX(i, j, size)], x[GET_IDX(j, i, size)]);
+                }
+            }
+            return;
+        }
+
+        //two smaller diagonal blocks, and the block above the diagonal in between them,
+        //which takes care of its mirror below the diagonal
+        int half = len / 2;
+        bool spawn = worth_spawning(len, len);
+        fork_join(spawn,
+            [=]{
+                fork_join(spawn,
+                    [=]{ transpose_diagonal(x, size, d0, half); },
+                    [=]{ transpose_diagonal(x, size, d0 + half, len - half); });
+            },
+            [=]{ swap_transposed(x, size, d0, d0 + half, half, len - half); });
 
-    void ParallelMatrixTransposePartial::execute(){
+    }
 
-        int num_blocks_x = (size / block_width);
-        int num_blocks_y = num_blocks_x;
-        int start_idx_x = (block_idx % num_blocks_x) * block_width;
-        int start_idx_y = (block_idx / num_blocks_y) * block_width;
+    //writes the transpose of the rows x cols block of in at (i0, j0) to out
+    template<typename T>
+    void transpose_into(T* out, const T* in, int size, int i0, int j0, int rows, int cols){
 
-        int idxA, idxB, temp;
+        if (rows <= TILE && cols <= TILE){
+            T buf[TILE * TILE];
 
-        //top corner is on half of transpose that isn't doing work
-        if ((start_idx_x + block_width) > (start_idx_y + block_width)){
+            load_tile(buf, &in[GET_IDX(i0, j0, size)], size, rows, cols);
+            store_tile_transposed(&out[GET_IDX(j0, i0, size)], buf, size, rows, cols);
             return;
         }
 
+        bool spawn = worth_spawning(rows, cols);
+        if (rows >= cols){
+            int half = rows / 2;
+            fork_join(spawn,
+                [=]{ transpose_into(out, in, size, i0, j0, half, cols); },
+                [=]{ transpose_into(out, in, size, i0 + half, j0, rows - half, cols); });
+        } else {
+            int half = cols / 2;
+            fork_join(spawn,
+                [=]{ transpose_into(out, in, size, i0, j0, rows, half); },
+                [=]{ transpose_into(out, in, size, i0, j0 + half, rows, cols - half); });
+        }
 
-        for( int i = start_idx_x; i < start_idx_x + block_width; i++) {
-            for (int j = start_idx_y; j < start_idx_y + block_width; j++) {
+    }
 
-                //only swap elements on one side of diagonal of matrix
-                if (i <= j){
 
-                    idxA = GET_IDX(i, j, size);
-                    idxB = GET_IDX(j, i, size);
+    template<typename T>
+    void parallelMatrixTranspose(T* x, int size){
+
+        //runs as a root task when called from outside of any task
+        WSDS::TaskGroup group(parSchedMat);
+        group.spawn([=]{ transpose_diagonal(x, size, 0, size); });
+        group.sync();
+
+    }
+
+    template<typename T>
+    void parallelMatrixTranspose(T* out, const T* in, int size){
+
+        WSDS::TaskGroup group(parSchedMat);
+        group.spawn([=]{ transpose_into(out, in, size, 0, 0, size, size); });
+        group.sync();
+
+    }
 
-                    temp = x[idxA];
-                    x[idxA] = x[idxB];
-                    x[idxB] = temp;
-                }
 
+    /******************************************************************/
+    /*                    Matrix Multiply                             */
+    /******************************************************************/
+
+    //blocking of the multiply: micro-kernels compute MR x NR blocks of out in registers
+    //(two AVX2 registers per row), tasks compute MC x NC tiles of out, and panels of A
+    //and B are packed KC deep, so a packed B micro-panel stays in L1 and the packed A
+    //block in L2
+    template<typename T>
+    struct GemmShape {
+        static constexpr int MR = 6;
+        static constexpr int NR = 64 / sizeof(T);
+        static constexpr int MC = 96;
+        static constexpr int NC = 256;
+        static constexpr int KC = 256;
+    };
+
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+
+
+    //packs mc rows and kc columns of A into micro-panels of MR rows, each stored one
+    //column after the other, padding the last micro-panel with zeros
+    template<typename T>
+    void pack_a(T* packed, const T* A, int lda, int mc, int kc){
+        const int MR = GemmShape<T>::MR;
+
+        for (int i0 = 0; i0 < mc; i0 += MR){
+            int rows = std::min(MR, mc - i0);
+            for (int k = 0; k < kc; k++){
+                for (int r = 0; r < MR; r++){
+                    *packed++ = (r < rows) ? A[GET_IDX(i0 + r, k, lda)] : T(0);
+                }
             }
         }
-
     }
 
+    //packs kc rows and nc columns of B into micro-panels of NR columns, each stored one
+    //row after the other, padding the last micro-panel with zeros
+    template<typename T>
+    void pack_b(T* packed, const T* B, int ldb, int kc, int nc){
+        const int NR = GemmShape<T>::NR;
+
+        for (int j0 = 0; j0 < nc; j0 += NR){
+            int cols = std::min(NR, nc - j0);
+            for (int k = 0; k < kc; k++){
+                const T* row = &B[GET_IDX(k, j0, ldb)];
+                for (int c = 0; c < NR; c++){
+                    *packed++ = (c < cols) ? row[c] : T(0);
+                }
+            }
+        }
+    }
 
-    void parallelMatrixMultiply(int* out, int* A, int* B, int size){
 
+    //portable micro-kernel, ab = a x b for an MR x kc micro-panel a and a kc x NR
+    //micro-panel b, ab is stored row by row
+    template<typename T>
+    void micro_kernel_generic(int kc, const T* a, const T* b, T* ab){
+        const int MR = GemmShape<T>::MR;
+        const int NR = GemmShape<T>::NR;
+        T c[MR][NR] = {};
 
-        int i,j;
-        int num_sub_tasks = size; //task for each i, j
+        for (int k = 0; k < kc; k++){
+            for (int r = 0; r < MR; r++){
+                for (int j = 0; j < NR; j++){
+                    c[r][j] += a[r] * b[j];
+                }
+            }
+            a += MR;
+            b += NR;
+        }
 
+        for (int r = 0; r < MR; r++){
+            for (int j = 0; j < NR; j++){
+                ab[r*NR + j] = c[r][j];
+            }
+        }
+    }
 
-        //transpose B to create sequential array
-        parallelMatrixTranspose(B, size);
+    //AVX2 micro-kernels, the 6 x 2 accumulators stay in registers for the whole kc loop,
+    //which broadcasts one element of a against two registers of b per row; the row loops
+    //must be unrolled for the accumulators to get registers of their own
+    __attribute__((target("avx2,fma")))
+    void micro_kernel_avx2(int kc, const float* a, const float* b, float* ab){
+        __m256 c[6][2];
+#pragma GCC unroll 6
+        for (int r = 0; r < 6; r++){
+            c[r][0] = _mm256_setzero_ps();
+            c[r][1] = _mm256_setzero_ps();
+        }
 
-        ParallelMatrixMultiplyPartial* tasks[num_sub_tasks][num_sub_tasks];
+        for (int k = 0; k < kc; k++){
+            __m256 b0 = _mm256_loadu_ps(b);
+            __m256 b1 = _mm256_loadu_ps(b + 8);
+#pragma GCC unroll 6
+            for (int r = 0; r < 6; r++){
+                __m256 ar = _mm256_broadcast_ss(a + r);
+                c[r][0] = _mm256_fmadd_ps(ar, b0, c[r][0]);
+                c[r][1] = _mm256_fmadd_ps(ar, b1, c[r][1]);
+            }
+            a += 6;
+            b += 16;
+        }
 
+#pragma GCC unroll 6
+        for (int r = 0; r < 6; r++){
+            _mm256_storeu_ps(ab + r*16, c[r][0]);
+            _mm256_storeu_ps(ab + r*16 + 8, c[r][1]);
+        }
+    }
 
-        for (i = 0; i < num_sub_tasks; i++){
-            for (j = 0; j < num_sub_tasks; j++){
+    __attribute__((target("avx2,fma")))
+    void micro_kernel_avx2(int kc, const double* a, const double* b, double* ab){
+        __m256d c[6][2];
+#pragma GCC unroll 6
+        for (int r = 0; r < 6; r++){
+            c[r][0] = _mm256_setzero_pd();
+            c[r][1] = _mm256_setzero_pd();
+        }
 
-                tasks[i][j] = new ParallelMatrixMultiplyPartial(out, A, B, size, i, j);
-                parSchedMat->spawn(tasks[i][j]);
+        for (int k = 0; k < kc; k++){
+            __m256d b0 = _mm256_loadu_pd(b);
+            __m256d b1 = _mm256_loadu_pd(b + 4);
+#pragma GCC unroll 6
+            for (int r = 0; r < 6; r++){
+                __m256d ar = _mm256_broadcast_sd(a + r);
+                c[r][0] = _mm256_fmadd_pd(ar, b0, c[r][0]);
+                c[r][1] = _mm256_fmadd_pd(ar, b1, c[r][1]);
             }
+            a += 6;
+            b += 8;
         }
 
-        parSchedMat->wait();
+#pragma GCC unroll 6
+        for (int r = 0; r < 6; r++){
+            _mm256_storeu_pd(ab + r*8, c[r][0]);
+            _mm256_storeu_pd(ab + r*8 + 4, c[r][1]);
+        }
+    }
 
-        for (i = 0; i < num_sub_tasks; i++){
-            for (j = 0; j < num_sub_tasks; j++){
-                delete tasks[i][j];
+    __attribute__((target("avx2")))
+    void micro_kernel_avx2(int kc, const int* a, const int* b, int* ab){
+        __m256i c[6][2];
+#pragma GCC unroll 6
+        for (int r = 0; r < 6; r++){
+            c[r][0] = _mm256_setzero_si256();
+            c[r][1] = _mm256_setzero_si256();
+        }
+
+        for (int k = 0; k < kc; k++){
+            __m256i b0 = _mm256_loadu_si256((const __m256i*)b);
+            __m256i b1 = _mm256_loadu_si256((const __m256i*)(b + 8));
+#pragma GCC unroll 6
+            for (int r = 0; r < 6; r++){
+                __m256i ar = _mm256_set1_epi32(a[r]);
+                c[r][0] = _mm256_add_epi32(c[r][0], _mm256_mullo_epi32(ar, b0));
+                c[r][1] = _mm256_add_epi32(c[r][1], _mm256_mullo_epi32(ar, b1));
             }
+            a += 6;
+            b += 16;
         }
 
-        //convert B back
-        parallelMatrixTranspose(B, size);
+#pragma GCC unroll 6
+        for (int r = 0; r < 6; r++){
+            _mm256_storeu_si256((__m256i*)(ab + r*16), c[r][0]);
+            _mm256_storeu_si256((__m256i*)(ab + r*16 + 8), c[r][1]);
+        }
     }
 
+    //element types with an AVX2 micro-kernel, all others use the generic one
+    template<typename T>
+    struct HasAvx2Kernel : std::false_type {};
+    template<> struct HasAvx2Kernel<int> : std::true_type {};
+    template<> struct HasAvx2Kernel<float> : std::true_type {};
+    template<> struct HasAvx2Kernel<double> : std::true_type {};
+
+    template<typename T>
+    void micro_kernel(int kc, const T* a, const T* b, T* ab){
+        if constexpr (HasAvx2Kernel<T>::value){
+            if (hasAvx2){
+                micro_kernel_avx2(kc, a, b, ab);
+                return;
+            }
+        }
+        micro_kernel_generic(kc, a, b, ab);
+    }
+
+
+    //computes the tile of out starting at row i0 and column j0
+    template<typename T>
+    void multiply_tile(T* out, const T* A, const T* B, int size, int i0, int j0){
+        const int MR = GemmShape<T>::MR;
+        const int NR = GemmShape<T>::NR;
+        const int KC = GemmShape<T>::KC;
+
+        int mc = std::min(GemmShape<T>::MC, size - i0);
+        int nc = std::min(GemmShape<T>::NC, size - j0);
+
+        //packing buffers are reused by all tiles a worker computes
+        thread_local std::vector<T> packedA;
+        thread_local std::vector<T> packedB;
+        packedA.resize((mc + MR - 1) / MR * MR * KC);
+        packedB.resize((nc + NR - 1) / NR * NR * KC);
+
+        T ab[MR * NR];
+
+        for (int p0 = 0; p0 < size; p0 += KC){
+            int kc = std::min(KC, size - p0);
+
+            pack_a(packedA.data(), &A[GET_IDX(i0, p0, size)], size, mc, kc);
+            pack_b(packedB.data(), &B[GET_IDX(p0, j0, size)], size, kc, nc);
+
+            for (int jr = 0; jr < nc; jr += NR){
+                for (int ir = 0; ir < mc; ir += MR){
+                    micro_kernel(kc, &packedA[ir * kc], &packedB[jr * kc], ab);
 
-    ParallelMatrixMultiplyPartial::ParallelMatrixMultiplyPartial(int* out, int* A, int* B, int size, int i, int j){
-        this->out = out;
-        this->A = A;
-        this->B = B;
-        this->size = size;
-        this->i = i;
-        this->j = j;
+                    //add the block to out, minus the padding at the edges
+                    int rows = std::min(MR, mc - ir);
+                    int cols = std::min(NR, nc - jr);
+                    for (int r = 0; r < rows; r++){
+                        T* dst = &out[GET_IDX(i0 + ir + r, j0 + jr, size)];
+                        for (int c = 0; c < cols; c++){
+                            dst[c] = (p0 == 0) ? ab[r*NR + c] : dst[c] + ab[r*NR + c];
+                        }
+                    }
+                }
+            }
+        }
     }
 
-    void ParallelMatrixMultiplyPartial::execute(){
+    template<typename T>
+    void multiply(T* out, const T* A, const T* B, int size){
+        int tilesM = (size + GemmShape<T>::MC - 1) / GemmShape<T>::MC;
+        int tilesN = (size + GemmShape<T>::NC - 1) / GemmShape<T>::NC;
 
-        //multiply the elements of the array together
-        int* temp = new int[size];
-        parallelMultiply(temp, &A[i*size], &B[j*size], size, this);
-        out[GET_IDX(i, j, size)] = parallelReduce(temp, size, this);
-        delete temp;
+        WSDS::parallel_for(0, tilesM * tilesN, 1, [=](int first, int last){
+            for (int t = first; t < last; t++){
+                multiply_tile(out, A, B, size, (t / tilesN) * GemmShape<T>::MC, (t % tilesN) * GemmShape<T>::NC);
+            }
+        }, parSchedMat);
+    }
 
 
+    template<typename T>
+    void parallelMatrixMultiply(T* out, const T* A, const T* B, int size){
+        multiply(out, A, B, size);
     }
 
 
+    //the element types the library is built for
+    template void parallelMatrixTranspose<int>(int* x, int size);
+    template void parallelMatrixTranspose<int64_t>(int64_t* x, int size);
+    template void parallelMatrixTranspose<float>(float* x, int size);
+    template void parallelMatrixTranspose<double>(double* x, int size);
+
+    template void parallelMatrixTranspose<int>(int* out, const int* in, int size);
+    template void parallelMatrixTranspose<int64_t>(int64_t* out, const int64_t* in, int size);
+    template void parallelMatrixTranspose<float>(float* out, const float* in, int size);
+    template void parallelMatrixTranspose<double>(double* out, const double* in, int size);
+
+    template void parallelMatrixMultiply<int>(int* out, const int* A, const int* B, int size);
+    template void parallelMatrixMultiply<int64_t>(int64_t* out, const int64_t* A, const int64_t* B, int size);
+    template void parallelMatrixMultiply<float>(float* out, const float* A, const float* B, int size);
+    template void parallelMatrixMultiply<double>(double* out, const double* A, const double* B, int size);
+
 
 }
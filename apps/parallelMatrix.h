@@ -4,7 +4,7 @@
 
 
 #ifndef _PARALLEL_MATRIX_DEFINE
-#define _PARAKLLELMATRIX_DEFINE
+#define _PARALLEL_MATRIX_DEFINE
 
 #include "task.h"
 #include "scheduler.h"
@@ -12,7 +12,10 @@
 namespace BENCHMARKS {
 
 
-#define GET_IDX(row, col, size) (row*size + col)
+#define GET_IDX(row, col, size) ((row)*(size) + (col))
+
+    //transpose and multiply are templates over the element type, built for int, int64_t,
+    //float and double
 
     /******************************************************************/
     /*                    Library Initialization                      */
@@ -26,62 +29,30 @@ namespace BENCHMARKS {
     /*                    Matrix Transpose                            */
     /******************************************************************/
 
+    //will transpose a matrix that is a (size x size) square matrix in place.  X should be a
+    //2-D array in row-major order, of any size.  The matrix is split recursively, and only
+    //the blocks on and above the diagonal get a task, which swaps them with their mirror
+    //blocks below the diagonal
+    template<typename T>
+    void parallelMatrixTranspose(T* x, int size);
 
-    //will transpose a matrix that is a (size x size) square matrix.  X should be a 2-D array
-    void parallelMatrixTranspose(int* x, int size);
-
-
-    class ParallelMatrixTransposePartial : public WSDS::Task {
-
-    public:
-
-
-
-        ParallelMatrixTransposePartial(int* x, int size, int block_width, int block_idx);
-
-        //will spawn thread that will divide and conquer on matrix transpose
-        void execute();
-
-    private:
-
-        int * x;
-        int size;
-        int block_width;
-        int block_idx;
-
-    };
+    //will write the transpose of the (size x size) square matrix in to out, also split
+    //recursively
+    template<typename T>
+    void parallelMatrixTranspose(T* out, const T* in, int size);
 
 
     /******************************************************************/
     /*                    Matrix Multiply                             */
     /******************************************************************/
 
-    //will multiply a matrix that is a (size x size) square matrix.  A/B/OUT should all be 2-D arrays
-    void parallelMatrixMultiply(int* out, int* A, int* B, int size);
-
-
-    class ParallelMatrixMultiplyPartial : public WSDS::Task {
-
-    public:
-
-        ParallelMatrixMultiplyPartial(int* out, int* A, int* B, int size, int i, int j);
-
-        void execute();
-
-    private:
-
-        int * out;
-        int * A;
-        int * B;
-        int size;
-
-        int i; //A row operating on
-        int j; //B row operating on
-
-
-    };
-
-
+    //will multiply a matrix that is a (size x size) square matrix, out = A x B.  A/B/OUT
+    //should all be 2-D arrays in row-major order.  Every task computes a tile of out from
+    //packed panels of A and B with register-blocked micro-kernels, using AVX2 if the cpu
+    //supports it.  The kernels are specific to + and x, and built for int, int64_t, float
+    //and double, of which only int64_t has no AVX2 kernel
+    template<typename T>
+    void parallelMatrixMultiply(T* out, const T* A, const T* B, int size);
 
 
 }
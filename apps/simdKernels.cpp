@@ -0,0 +1,389 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#include "simdKernels.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <functional>
+#include <string.h>
+#include <unistd.h>
+
+namespace BENCHMARKS {
+
+
+    /****************************************************************/
+    /*            Vector Operations                                 */
+    /****************************************************************/
+
+    //the vector operations of an instruction set, by element type: unaligned loads, aligned
+    //stores, non-temporal stores, adds and multiplies.  Each is compiled for its instruction
+    //set, and gets inlined into kernels flattened for the same instruction set
+
+    //SSE2 is part of x86-64, so needs no target attribute
+    struct Sse2 {
+        static constexpr int bytes = 16;
+        template<typename T> struct Vec;
+    };
+
+    template<> struct Sse2::Vec<int> {
+        typedef __m128i type;
+        static type load(const int* p){ return _mm_loadu_si128((const __m128i*)p); }
+        static void store(int* p, type v){ _mm_store_si128((__m128i*)p, v); }
+        static void stream(int* p, type v){ _mm_stream_si128((__m128i*)p, v); }
+        static type add(type a, type b){ return _mm_add_epi32(a, b); }
+
+        //SSE2 has no 32-bit multiply, so multiply the even and the odd lanes into 64 bits
+        //each, and put the low halves of the products back together
+        static type mul(type a, type b){
+            __m128i even = _mm_mul_epu32(a, b);
+            __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+            return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                      _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+        }
+    };
+
+    template<> struct Sse2::Vec<int64_t> {
+        typedef __m128i type;
+        static type load(const int64_t* p){ return _mm_loadu_si128((const __m128i*)p); }
+        static void store(int64_t* p, type v){ _mm_store_si128((__m128i*)p, v); }
+        static type add(type a, type b){ return _mm_add_epi64(a, b); }
+    };
+
+    template<> struct Sse2::Vec<float> {
+        typedef __m128 type;
+        static type load(const float* p){ return _mm_loadu_ps(p); }
+        static void store(float* p, type v){ _mm_store_ps(p, v); }
+        static type add(type a, type b){ return _mm_add_ps(a, b); }
+        static type mul(type a, type b){ return _mm_mul_ps(a, b); }
+    };
+
+    template<> struct Sse2::Vec<double> {
+        typedef __m128d type;
+        static type load(const double* p){ return _mm_loadu_pd(p); }
+        static void store(double* p, type v){ _mm_store_pd(p, v); }
+        static type add(type a, type b){ return _mm_add_pd(a, b); }
+        static type mul(type a, type b){ return _mm_mul_pd(a, b); }
+    };
+
+
+    struct Avx2 {
+        static constexpr int bytes = 32;
+        template<typename T> struct Vec;
+    };
+
+    template<> struct Avx2::Vec<int> {
+        typedef __m256i type;
+        __attribute__((target("avx2"))) static type load(const int* p){ return _mm256_loadu_si256((const __m256i*)p); }
+        __attribute__((target("avx2"))) static void store(int* p, type v){ _mm256_store_si256((__m256i*)p, v); }
+        __attribute__((target("avx2"))) static void stream(int* p, type v){ _mm256_stream_si256((__m256i*)p, v); }
+        __attribute__((target("avx2"))) static type add(type a, type b){ return _mm256_add_epi32(a, b); }
+        __attribute__((target("avx2"))) static type mul(type a, type b){ return _mm256_mullo_epi32(a, b); }
+    };
+
+    template<> struct Avx2::Vec<int64_t> {
+        typedef __m256i type;
+        __attribute__((target("avx2"))) static type load(const int64_t* p){ return _mm256_loadu_si256((const __m256i*)p); }
+        __attribute__((target("avx2"))) static void store(int64_t* p, type v){ _mm256_store_si256((__m256i*)p, v); }
+        __attribute__((target("avx2"))) static type add(type a, type b){ return _mm256_add_epi64(a, b); }
+    };
+
+    template<> struct Avx2::Vec<float> {
+        typedef __m256 type;
+        __attribute__((target("avx2"))) static type load(const float* p){ return _mm256_loadu_ps(p); }
+        __attribute__((target("avx2"))) static void store(float* p, type v){ _mm256_store_ps(p, v); }
+        __attribute__((target("avx2"))) static type add(type a, type b){ return _mm256_add_ps(a, b); }
+        __attribute__((target("avx2"))) static type mul(type a, type b){ return _mm256_mul_ps(a, b); }
+    };
+
+    template<> struct Avx2::Vec<double> {
+        typedef __m256d type;
+        __attribute__((target("avx2"))) static type load(const double* p){ return _mm256_loadu_pd(p); }
+        __attribute__((target("avx2"))) static void store(double* p, type v){ _mm256_store_pd(p, v); }
+        __attribute__((target("avx2"))) static type add(type a, type b){ return _mm256_add_pd(a, b); }
+        __attribute__((target("avx2"))) static type mul(type a, type b){ return _mm256_mul_pd(a, b); }
+    };
+
+
+    struct Avx512 {
+        static constexpr int bytes = 64;
+        template<typename T> struct Vec;
+    };
+
+    template<> struct Avx512::Vec<int> {
+        typedef __m512i type;
+        __attribute__((target("avx512f"))) static type load(const int* p){ return _mm512_loadu_si512(p); }
+        __attribute__((target("avx512f"))) static void store(int* p, type v){ _mm512_store_si512(p, v); }
+        __attribute__((target("avx512f"))) static void stream(int* p, type v){ _mm512_stream_si512((__m512i*)p, v); }
+        __attribute__((target("avx512f"))) static type add(type a, type b){ return _mm512_add_epi32(a, b); }
+        __attribute__((target("avx512f"))) static type mul(type a, type b){ return _mm512_mullo_epi32(a, b); }
+    };
+
+    template<> struct Avx512::Vec<int64_t> {
+        typedef __m512i type;
+        __attribute__((target("avx512f"))) static type load(const int64_t* p){ return _mm512_loadu_si512(p); }
+        __attribute__((target("avx512f"))) static void store(int64_t* p, type v){ _mm512_store_si512(p, v); }
+        __attribute__((target("avx512f"))) static type add(type a, type b){ return _mm512_add_epi64(a, b); }
+    };
+
+    template<> struct Avx512::Vec<float> {
+        typedef __m512 type;
+        __attribute__((target("avx512f"))) static type load(const float* p){ return _mm512_loadu_ps(p); }
+        __attribute__((target("avx512f"))) static void store(float* p, type v){ _mm512_store_ps(p, v); }
+        __attribute__((target("avx512f"))) static type add(type a, type b){ return _mm512_add_ps(a, b); }
+        __attribute__((target("avx512f"))) static type mul(type a, type b){ return _mm512_mul_ps(a, b); }
+    };
+
+    template<> struct Avx512::Vec<double> {
+        typedef __m512d type;
+        __attribute__((target("avx512f"))) static type load(const double* p){ return _mm512_loadu_pd(p); }
+        __attribute__((target("avx512f"))) static void store(double* p, type v){ _mm512_store_pd(p, v); }
+        __attribute__((target("avx512f"))) static type add(type a, type b){ return _mm512_add_pd(a, b); }
+        __attribute__((target("avx512f"))) static type mul(type a, type b){ return _mm512_mul_pd(a, b); }
+    };
+
+
+    /****************************************************************/
+    /*            Kernel Loops                                      */
+    /****************************************************************/
+
+    //number of bytes from p to the next address aligned to the vector size, at most limit
+    template<typename Isa>
+    long bytes_to_aligned(const void* p, long limit){
+        return std::min(limit, (long)(-(uintptr_t)p & (Isa::bytes - 1)));
+    }
+
+    //the kernel loops pass AVX2 and AVX-512 vectors by value to and from the vector
+    //operations, which GCC warns about as the loops themselves are not compiled for those
+    //instruction sets.  They are only ever inlined into kernels that are, see below
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+    //out[i] = op(a[i], b[i]) for i in [0, n), op being std::plus or std::multiplies: one
+    //element at a time up to the first element of out aligned to the vector size, whole
+    //vectors from there, and the rest one at a time
+    template<typename Isa, typename T, typename Op>
+    void apply_loop(T* out, const T* a, const T* b, long n, Op op){
+        typedef typename Isa::template Vec<T> V;
+        const long lanes = Isa::bytes / sizeof(T);
+
+        long i = 0;
+        for (long head = bytes_to_aligned<Isa>(out, n * sizeof(T)) / sizeof(T); i < head; i++){
+            out[i] = op(a[i], b[i]);
+        }
+
+#pragma GCC unroll 4
+        for (; i + lanes <= n; i += lanes){
+            if constexpr (std::is_same<Op, std::plus<T>>::value){
+                V::store(out + i, V::add(V::load(a + i), V::load(b + i)));
+            } else {
+                V::store(out + i, V::mul(V::load(a + i), V::load(b + i)));
+            }
+        }
+
+        for (; i < n; i++){
+            out[i] = op(a[i], b[i]);
+        }
+    }
+
+    //copies bytes from in to out, like apply_loop.  Non-temporal stores go to a write
+    //combining buffer rather than the cache, and are only ordered with later stores, such
+    //as the task's completion, by the fence
+    template<typename Isa>
+    void copy_loop(void* out, const void* in, long bytes, bool stream){
+        typedef typename Isa::template Vec<int> V;
+        char* dst = (char*)out;
+        const char* src = (const char*)in;
+
+        long i = bytes_to_aligned<Isa>(dst, bytes);
+        memcpy(dst, src, i);
+
+        if (stream){
+#pragma GCC unroll 4
+            for (; i + Isa::bytes <= bytes; i += Isa::bytes){
+                V::stream((int*)(dst + i), V::load((const int*)(src + i)));
+            }
+            _mm_sfence();
+        } else {
+#pragma GCC unroll 4
+            for (; i + Isa::bytes <= bytes; i += Isa::bytes){
+                V::store((int*)(dst + i), V::load((const int*)(src + i)));
+            }
+        }
+
+        memcpy(dst + i, src + i, bytes - i);
+    }
+
+#pragma GCC diagnostic pop
+
+
+    /****************************************************************/
+    /*            Kernels                                           */
+    /****************************************************************/
+
+    //every kernel is flattened, which inlines the kernel loop and the vector operations into
+    //it, so they are all compiled for the kernel's instruction set
+
+    template<typename T, typename Op>
+    void apply_none(T* out, const T* a, const T* b, long n){
+        for (long i = 0; i < n; i++){
+            out[i] = Op()(a[i], b[i]);
+        }
+    }
+
+    template<typename T, typename Op>
+    __attribute__((flatten))
+    void apply_sse2(T* out, const T* a, const T* b, long n){
+        apply_loop<Sse2>(out, a, b, n, Op());
+    }
+
+    template<typename T, typename Op>
+    __attribute__((target("avx2"), flatten))
+    void apply_avx2(T* out, const T* a, const T* b, long n){
+        apply_loop<Avx2>(out, a, b, n, Op());
+    }
+
+    template<typename T, typename Op>
+    __attribute__((target("avx512f"), flatten))
+    void apply_avx512(T* out, const T* a, const T* b, long n){
+        apply_loop<Avx512>(out, a, b, n, Op());
+    }
+
+    void copy_none(void* out, const void* in, long bytes, bool stream){
+        memcpy(out, in, bytes);
+    }
+
+    __attribute__((flatten))
+    void copy_sse2(void* out, const void* in, long bytes, bool stream){
+        copy_loop<Sse2>(out, in, bytes, stream);
+    }
+
+    __attribute__((target("avx2"), flatten))
+    void copy_avx2(void* out, const void* in, long bytes, bool stream){
+        copy_loop<Avx2>(out, in, bytes, stream);
+    }
+
+    __attribute__((target("avx512f"), flatten))
+    void copy_avx512(void* out, const void* in, long bytes, bool stream){
+        copy_loop<Avx512>(out, in, bytes, stream);
+    }
+
+
+    //the kernels of one instruction set
+    struct KernelTable {
+        void (*addInt)(int*, const int*, const int*, long);
+        void (*addInt64)(int64_t*, const int64_t*, const int64_t*, long);
+        void (*addFloat)(float*, const float*, const float*, long);
+        void (*addDouble)(double*, const double*, const double*, long);
+        void (*multiplyInt)(int*, const int*, const int*, long);
+        void (*multiplyFloat)(float*, const float*, const float*, long);
+        void (*multiplyDouble)(double*, const double*, const double*, long);
+        void (*copy)(void*, const void*, long, bool);
+    };
+
+#define KERNEL_TABLE(apply, copy) { \
+        apply<int, std::plus<int>>, apply<int64_t, std::plus<int64_t>>, \
+        apply<float, std::plus<float>>, apply<double, std::plus<double>>, \
+        apply<int, std::multiplies<int>>, apply<float, std::multiplies<float>>, \
+        apply<double, std::multiplies<double>>, copy }
+
+    //kernel tables indexed by SimdLevel
+    static const KernelTable tables[] = {
+        KERNEL_TABLE(apply_none, copy_none),
+        KERNEL_TABLE(apply_sse2, copy_sse2),
+        KERNEL_TABLE(apply_avx2, copy_avx2),
+        KERNEL_TABLE(apply_avx512, copy_avx512),
+    };
+
+
+    /****************************************************************/
+    /*            Dispatch                                          */
+    /****************************************************************/
+
+    SimdLevel simdSupported(){
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")){
+            return SIMD_AVX512;
+        }
+        if (__builtin_cpu_supports("avx2")){
+            return SIMD_AVX2;
+        }
+        return SIMD_SSE2;
+    }
+
+    //size of the largest cache the system reports
+    long last_level_cache_size(){
+        long size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+        if (size <= 0){
+            size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        }
+        return (size > 0) ? size : 8 << 20;
+    }
+
+    static SimdLevel level = simdSupported();
+    static const KernelTable* kernels = &tables[level];
+    static long threshold = last_level_cache_size();
+
+    SimdLevel simdLevel(){
+        return level;
+    }
+
+    SimdLevel setSimdLevel(SimdLevel wanted){
+        level = std::min(wanted, simdSupported());
+        kernels = &tables[level];
+        return level;
+    }
+
+    const char* simdLevelName(SimdLevel level){
+        switch (level){
+            case SIMD_NONE: return "none";
+            case SIMD_SSE2: return "sse2";
+            case SIMD_AVX2: return "avx2";
+            case SIMD_AVX512: return "avx512";
+        }
+        return "unknown";
+    }
+
+    long streamingThreshold(){
+        return threshold;
+    }
+
+    void setStreamingThreshold(long bytes){
+        threshold = bytes;
+    }
+
+
+    void simdAdd(int* out, const int* a, const int* b, long n){
+        kernels->addInt(out, a, b, n);
+    }
+
+    void simdAdd(int64_t* out, const int64_t* a, const int64_t* b, long n){
+        kernels->addInt64(out, a, b, n);
+    }
+
+    void simdAdd(float* out, const float* a, const float* b, long n){
+        kernels->addFloat(out, a, b, n);
+    }
+
+    void simdAdd(double* out, const double* a, const double* b, long n){
+        kernels->addDouble(out, a, b, n);
+    }
+
+    void simdMultiply(int* out, const int* a, const int* b, long n){
+        kernels->multiplyInt(out, a, b, n);
+    }
+
+    void simdMultiply(float* out, const float* a, const float* b, long n){
+        kernels->multiplyFloat(out, a, b, n);
+    }
+
+    void simdMultiply(double* out, const double* a, const double* b, long n){
+        kernels->multiplyDouble(out, a, b, n);
+    }
+
+    void simdCopyBytes(void* out, const void* in, long bytes, bool stream){
+        kernels->copy(out, in, bytes, stream);
+    }
+
+
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#ifndef _SIMD_KERNELS_DEFINE
+#define _SIMD_KERNELS_DEFINE
+
+#include <stdint.h>
+#include <type_traits>
+
+namespace BENCHMARKS {
+
+    /*
+     * Hand-written SSE2, AVX2 and AVX-512 kernels for the element-wise array
+     * operations, each working on one piece of an array. The best instruction
+     * set the cpu supports is picked at runtime, the kernels are compiled for
+     * each of them regardless of the compiler flags.
+     *
+     * Kernels work their way up to the first element of out aligned to the
+     * vector size one element at a time, store whole aligned vectors from
+     * there on, and finish off the elements left over one at a time again.
+     */
+
+
+    /****************************************************************/
+    /*            Instruction Sets                                  */
+    /****************************************************************/
+
+    //instruction sets there are kernels for, from worst to best, SIMD_NONE runs plain loops
+    enum SimdLevel { SIMD_NONE, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512 };
+
+    //best instruction set the cpu supports
+    SimdLevel simdSupported();
+
+    //instruction set the kernels currently use, the best one supported by default
+    SimdLevel simdLevel();
+
+    //makes the kernels use the given instruction set, or the best one supported if the cpu
+    //lacks it, and returns the one used.  Not to be called while kernels are running
+    SimdLevel setSimdLevel(SimdLevel level);
+
+    const char* simdLevelName(SimdLevel level);
+
+
+    /****************************************************************/
+    /*            Streaming Stores                                  */
+    /****************************************************************/
+
+    //copies of at least this many bytes in total are written with non-temporal stores, which
+    //bypass the caches, by default the size of the last level cache
+    long streamingThreshold();
+
+    //changes the streaming threshold.  Not to be called while kernels are running
+    void setStreamingThreshold(long bytes);
+
+
+    /****************************************************************/
+    /*            Kernels                                           */
+    /****************************************************************/
+
+    //out[i] = a[i] + b[i] for i in [0, n)
+    void simdAdd(int* out, const int* a, const int* b, long n);
+    void simdAdd(int64_t* out, const int64_t* a, const int64_t* b, long n);
+    void simdAdd(float* out, const float* a, const float* b, long n);
+    void simdAdd(double* out, const double* a, const double* b, long n);
+
+    //out[i] = a[i] * b[i] for i in [0, n), there is no vector multiply of 64-bit integers
+    //before AVX-512DQ, so int64_t uses the plain loop
+    void simdMultiply(int* out, const int* a, const int* b, long n);
+    void simdMultiply(float* out, const float* a, const float* b, long n);
+    void simdMultiply(double* out, const double* a, const double* b, long n);
+
+    //copies bytes from in to out, with non-temporal stores if stream is set
+    void simdCopyBytes(void* out, const void* in, long bytes, bool stream);
+
+
+    //element types without kernels of their own fall back to plain loops
+    template<typename T>
+    void simdAdd(T* out, const T* a, const T* b, long n){
+        for (long i = 0; i < n; i++){
+            out[i] = a[i] + b[i];
+        }
+    }
+
+    template<typename T>
+    void simdMultiply(T* out, const T* a, const T* b, long n){
+        for (long i = 0; i < n; i++){
+            out[i] = a[i] * b[i];
+        }
+    }
+
+    template<typename T>
+    void simdCopy(T* out, const T* in, long n, bool stream){
+        if constexpr (std::is_trivially_copyable<T>::value){
+            simdCopyBytes(out, in, n * (long)sizeof(T), stream);
+        } else {
+            for (long i = 0; i < n; i++){
+                out[i] = in[i];
+            }
+        }
+    }
+
+
+}
+
+#endif
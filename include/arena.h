@@ -0,0 +1,122 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#ifndef _WSDS_ARENA_DEFINE
+#define _WSDS_ARENA_DEFINE
+
+#include <atomic>
+#include <vector>
+#include "config.h"
+
+namespace WSDS {
+
+/*
+ * Internal data structures and functions not expected to be used
+ * by user applications utilizing the WSDS user-level scheduler.
+ */
+namespace internal {
+
+class TaskArena; // forward declaration, defined below
+
+/*
+ * BlockHeader struct is stored in front of every block handed out by a
+ * TaskArena, so that a block can be returned to the arena it came from
+ * no matter which thread releases it. While a block is free, the first
+ * bytes after its header link it into a free list.
+ */
+typedef struct alignas(16) _BlockHeader {
+    TaskArena* owner; // nullptr if allocated from the heap
+    int sizeClass;
+
+    _BlockHeader*& next(void) { return *reinterpret_cast<_BlockHeader**>(this + 1); }
+} BlockHeader;
+
+/*
+ * A slab allocator for task objects, owned by a single worker. Blocks are
+ * carved out of large slabs and sorted into a handful of size classes, and
+ * freed blocks are kept on per size class free lists for reuse.
+ *
+ * Only the owning worker's thread allocates from an arena and pushes to its
+ * free lists. Blocks released by any other thread are handed back to the
+ * owner in batches through a lock-free stack, which the owner drains once
+ * its own free list runs dry. Threads without an arena (e.g. the thread
+ * running main) fall back to the heap.
+ */
+class TaskArena {
+
+public:
+    TaskArena();
+    ~TaskArena();
+
+    // alignment guaranteed for allocated blocks
+    static constexpr size_t ALIGNMENT = sizeof(BlockHeader);
+
+    // allocate a block of at least size bytes from the arena of the
+    // calling thread, or from the heap if it has none
+    static void* allocate(size_t size);
+
+    // return a block to the arena it was allocated from
+    static void release(void* ptr);
+
+    // make this the arena of the calling thread, or remove the calling
+    // thread's arena if nullptr
+    static void set_current(TaskArena* arena);
+
+    // get the arena of the calling thread
+    static TaskArena* get_current(void) { return current; }
+
+    // hand any batched frees of the calling thread back to their owners
+    static void flush_pending(void);
+
+private:
+    static constexpr int NCLASSES = 8;
+    static constexpr size_t CLASS_SIZE = 64;
+    static constexpr size_t SLAB_SIZE = 64 * 1024;
+    static constexpr int BATCH_SIZE = 32;
+
+    static thread_local TaskArena* current;
+
+    // owner only state
+    BlockHeader* freeLists[NCLASSES];
+    std::vector<char*> slabs;
+    char* slabNext;
+    char* slabEnd;
+
+    // frees batched up by this arena's thread for another arena
+    TaskArena* pendingOwner;
+    BlockHeader* pendingHead;
+    BlockHeader* pendingTail;
+    int npending;
+
+    // blocks handed back by other threads
+    alignas(CACHE_LINE_SIZE) std::atomic<BlockHeader*> remoteFrees;
+
+    // allocate a block of the given size class
+    BlockHeader* allocate_block(int sizeClass);
+
+    // carve a new block of the given size class out of the current slab
+    BlockHeader* carve_block(int sizeClass);
+
+    // move all blocks handed back by other threads onto the free lists
+    void drain_remote_frees(void);
+
+    // push a chain of blocks onto this arena's remote free stack
+    void push_remote_frees(BlockHeader* head, BlockHeader* tail);
+
+    // batch up a block owned by another arena
+    void defer_release(BlockHeader* block);
+
+#ifdef _UNIT_TESTING
+public:
+    int get_npending(void) { return this->npending; }
+    size_t get_nslabs(void) { return this->slabs.size(); }
+#endif
+
+}; // class TaskArena
+
+} // namespace internal
+
+} // namespace WSDS
+
+#endif // _WSDS_ARENA_DEFINE
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#ifndef _WSDS_CONFIG_DEFINE
+#define _WSDS_CONFIG_DEFINE
+
+#include <stddef.h>
+
+/*
+ * Size in bytes of a cache line on the target machine. Data written by
+ * different threads is aligned to this size to avoid false sharing, and
+ * defining it to something small (e.g. -DWSDS_CACHE_LINE_SIZE=8) packs
+ * that data back together again for comparison.
+ */
+#ifndef WSDS_CACHE_LINE_SIZE
+#define WSDS_CACHE_LINE_SIZE 64
+#endif
+
+/*
+ * Most tasks a thief takes from a deep victim deque in a single steal.
+ * Defining it to 1 (e.g. -DWSDS_MAX_STEAL_BATCH=1) goes back to stealing
+ * one task at a time for comparison.
+ */
+#ifndef WSDS_MAX_STEAL_BATCH
+#define WSDS_MAX_STEAL_BATCH 32
+#endif
+
+/*
+ * Define WSDS_TRACE (e.g. -DWSDS_TRACE) to record when every task runs, and
+ * which steals succeed, on every worker. The events are written as a Chrome
+ * trace (viewable in chrome://tracing or Perfetto) to the file named by the
+ * WSDS_TRACE_FILE environment variable, or wsds-trace.json, once the
+ * scheduler is deleted. Without it, tracing compiles out entirely.
+ */
+
+namespace WSDS {
+
+/*
+ * Internal data structures and functions not expected to be used
+ * by user applications utilizing the WSDS user-level scheduler.
+ */
+namespace internal {
+
+static constexpr size_t CACHE_LINE_SIZE = WSDS_CACHE_LINE_SIZE;
+static constexpr int MAX_STEAL_BATCH = WSDS_MAX_STEAL_BATCH;
+
+} // namespace internal
+
+} // namespace WSDS
+
+#endif // _WSDS_CONFIG_DEFINE
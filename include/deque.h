@@ -5,13 +5,17 @@
 /*
  * Deque implementation is originally based on reference pseudocode provided
  * by Arora, Blumofe, and Plaxton in their paper on "Thread Scheduling for
- * Multiprogrammed Multiprocessors".
+ * Multiprogrammed Multiprocessors", and has since been reworked into the
+ * growable circular deque described by Chase and Lev in their paper on
+ * "Dynamic Circular Work-Stealing Deque".
  */
 
 #ifndef _WSDS_DEQUE_DEFINE
 #define _WSDS_DEQUE_DEFINE
 
 #include <atomic>
+#include <vector>
+#include "config.h"
 #include "task.h"
 
 namespace WSDS {
@@ -25,13 +29,28 @@ class Task; // forward declaration, defined elsewhere
 namespace internal {
 
 /*
- * Age struct is required by the current Deque implementation in order
- * to atomically update both tag and top via a compare and swap operation.
+ * CircularArray struct is the backing storage of the current Deque
+ * implementation. Indices into the array are never reset, and are instead
+ * wrapped around the (power of two) capacity of the array. Slots are only
+ * accessed with relaxed ordering, the Deque's fences order them.
  */
-typedef struct _Age {
-    unsigned int tag;
-    int top;
-} Age;
+typedef struct _CircularArray {
+    long capacity;
+    std::atomic<Task*>* slots;
+
+    _CircularArray(long capacity);
+    ~_CircularArray();
+
+    Task* get(long i) {
+        return this->slots[i & (this->capacity - 1)].load(std::memory_order_relaxed);
+    }
+    void put(long i, Task* task) {
+        this->slots[i & (this->capacity - 1)].store(task, std::memory_order_relaxed);
+    }
+
+    // allocate an array of double the capacity holding tasks [top, bottom)
+    _CircularArray* grow(long top, long bottom);
+} CircularArray;
 
 /*
  * A work-stealing deque (i.e. "double-ended queue") implementation to be used
@@ -39,16 +58,36 @@ typedef struct _Age {
  * own deques in a LIFO style, only pushing to and popping from the "bottom"
  * of the deque. However, when attempting to steal from another worker's deque,
  * work stealers will always pop from the top.
+ *
+ * The deque starts small and doubles its backing array whenever a push finds
+ * it full. Because work stealers may still be reading from an outgrown array,
+ * old arrays are retired rather than freed, and are only released when the
+ * deque itself is destroyed.
+ *
+ * Memory orderings follow the C11 version of the deque proven correct by
+ * Le, Pop, Cohen and Zappa Nardelli in "Correct and Efficient Work-Stealing
+ * for Weak Memory Models". The owner's push_bottom() only needs a release
+ * fence, while pop_bottom() and pop_top() each need a single seq_cst fence
+ * between their accesses of bottom and top.
  */
 class Deque {
 
 public:
-    Deque(int id, size_t size);
+    Deque(int id, size_t size = DEFAULT_SIZE);
     ~Deque();
 
+    // default initial number of task slots
+    static constexpr size_t DEFAULT_SIZE = 64;
+
     // remove and return a task from the "top" of the deque,
-    // only called by work stealers
-    Task* pop_top(void);
+    // only called by work stealers, if given aborted tells apart losing
+    // a race for a task (ABORT) from the deque being empty (EMPTY)
+    Task* pop_top(bool* aborted = nullptr);
+
+    // remove up to half of the tasks (at most maxTasks) from the "top" of
+    // the deque, returning the oldest and pushing the rest onto the bottom
+    // of into, which must be owned by the calling work stealer
+    Task* pop_top_batch(Deque* into, int maxTasks, bool* aborted = nullptr);
 
     // add a task to the "bottom" of the deque,
     // only called by the deque owner
@@ -61,23 +100,34 @@ public:
     // get the current number of tasks in the deque
     int get_num_tasks(void);
 
+    // get the index one past the bottom most task,
+    // only meaningful to the deque owner
+    long get_bottom_index(void) { return this->bottom.load(std::memory_order_relaxed); }
+
     // get allocated deque size
-    size_t get_size(void) { return this->size; }
+    size_t get_size(void) { return this->array.load(std::memory_order_acquire)->capacity; }
+
+    // get the id of the deque, same as its owning worker's
+    int get_id(void) { return this->id; }
 
 private:
     int id;
-    size_t size;
-    Task** collection;
-    std::atomic<internal::Age> age;
-    std::atomic<int> bottom;
+
+    // written by work stealers, kept on its own cache line so that stealing
+    // does not invalidate the owner's line holding bottom
+    alignas(CACHE_LINE_SIZE) std::atomic<long> top;
+
+    // written by the owner only
+    alignas(CACHE_LINE_SIZE) std::atomic<long> bottom;
+    std::atomic<CircularArray*> array;
+    std::vector<CircularArray*> retired; // outgrown arrays, only touched by owner
 
 #ifdef _UNIT_TESTING
 public:
-    int get_id(void) { return this->id; }
-    Task** get_collection(void) { return this->collection; }
-    unsigned int get_tag(void) { return this->age.load().tag; }
-    int get_top(void) { return this->age.load().top; }
-    int get_bottom(void) { return this->bottom.load(); }
+    Task* get_slot(long i) { return this->array.load(std::memory_order_acquire)->get(i); }
+    long get_top(void) { return this->top.load(std::memory_order_acquire); }
+    long get_bottom(void) { return this->bottom.load(std::memory_order_acquire); }
+    size_t get_nretired(void) { return this->retired.size(); }
 #endif
 
 }; // class Deque
@@ -0,0 +1,275 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#ifndef _WSDS_PARALLEL_DEFINE
+#define _WSDS_PARALLEL_DEFINE
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#include "scheduler.h"
+#include "taskgroup.h"
+#include "worker.h"
+
+namespace WSDS {
+
+static constexpr int INCLUSIVE_SCAN = 0;
+static constexpr int EXCLUSIVE_SCAN = 1;
+
+/*
+ * Internal data structures and functions not expected to be used
+ * by user applications utilizing the WSDS user-level scheduler.
+ */
+namespace internal {
+
+// run body over [begin, end) on the calling worker, splitting the range in
+// halves for thieves only while there is nothing left in our own deque
+template<typename Index, typename Body>
+void parallel_for_range(Index begin, Index end, Index grain, const Body& body) {
+    Worker* worker = Worker::get_current();
+    TaskGroup group;
+
+    while (end - begin > grain) {
+        if (worker->get_ready_deque_size() > 0) {
+            // the halves split off earlier have not been stolen yet, so
+            // nobody is short of work, keep going one grain at a time
+            body(begin, begin + grain);
+            begin += grain;
+            continue;
+        }
+
+        // hand the upper half to whoever steals it, keep the lower half
+        Index middle = begin + (end - begin) / 2;
+        group.spawn([=, &body] { parallel_for_range(middle, end, grain, body); });
+        end = middle;
+    }
+
+    body(begin, end);
+    group.sync();
+}
+
+// reduce [begin, end) on the calling worker, splitting the range in halves
+// for thieves only while there is nothing left in our own deque
+template<typename T, typename Index, typename Map, typename Combine>
+T parallel_reduce_range(Index begin, Index end, Index grain, const T& identity,
+                        const Map& map, const Combine& combine) {
+    Worker* worker = Worker::get_current();
+    T result = identity;
+
+    while (end - begin > grain) {
+        if (worker->get_ready_deque_size() > 0) {
+            // nobody is short of work, keep going one grain at a time
+            result = combine(result, map(begin, begin + grain));
+            begin += grain;
+            continue;
+        }
+
+        // hand the upper half to whoever steals it and reduce the lower
+        // half meanwhile, the two partial results meet once both are done
+        Index middle = begin + (end - begin) / 2;
+        T upper = identity;
+        TaskGroup group;
+        group.spawn([=, &upper, &identity, &map, &combine] {
+            upper = parallel_reduce_range(middle, end, grain, identity, map, combine);
+        });
+        T lower = parallel_reduce_range(begin, middle, grain, identity, map, combine);
+        group.sync();
+
+        return combine(combine(result, lower), upper);
+    }
+
+    return combine(result, map(begin, end));
+}
+
+// up-sweep kernel, reduces in[0, len), a plain loop the compiler can
+// vectorize when combine is a simple arithmetic operation
+template<typename T, typename Index, typename Combine>
+T scan_block_sum(const T* in, Index len, const T& identity, const Combine& combine) {
+    T acc = identity;
+    for (Index i = 0; i < len; i++) {
+        acc = combine(acc, in[i]);
+    }
+    return acc;
+}
+
+// down-sweep kernel, scans in[0, len) into out starting from offset, in may
+// be the same array as out
+template<typename T, typename Index, typename Combine>
+void scan_block(const T* in, T* out, Index len, T offset, const Combine& combine, int mode) {
+    if (mode == INCLUSIVE_SCAN) {
+        for (Index i = 0; i < len; i++) {
+            offset = combine(offset, in[i]);
+            out[i] = offset;
+        }
+    }
+    else {
+        for (Index i = 0; i < len; i++) {
+            T x = in[i];
+            out[i] = offset;
+            offset = combine(offset, x);
+        }
+    }
+}
+
+// scan in[0, size) into out on the calling worker, in two passes over
+// blocks of the array: the up-sweep reduces every block, an exclusive scan
+// of these sums gives each block its offset, and the down-sweep scans every
+// block from its offset
+template<typename T, typename Index, typename Combine>
+void parallel_scan_blocks(const T* in, T* out, Index size, Index grain, const T& identity,
+                          const Combine& combine, int mode) {
+    // blocks of at least two elements, so there are fewer block sums than
+    // elements, the last block may be short
+    Index block = std::max<Index>(grain, 2);
+    Index nblocks = (size + block - 1) / block;
+    std::vector<T> sums(nblocks, identity);
+    T* blockSums = sums.data();
+
+    parallel_for_range<Index>(0, nblocks, 1, [=, &combine, &identity](Index first, Index last) {
+        for (Index b = first; b < last; b++) {
+            Index len = std::min(block, size - b * block);
+            blockSums[b] = scan_block_sum(in + b * block, len, identity, combine);
+        }
+    });
+
+    // scan the block sums into block offsets, in parallel too when there
+    // are more of them than fit in one block
+    if (nblocks > block) {
+        parallel_scan_blocks(blockSums, blockSums, nblocks, grain, identity, combine, EXCLUSIVE_SCAN);
+    }
+    else {
+        scan_block(blockSums, blockSums, nblocks, identity, combine, EXCLUSIVE_SCAN);
+    }
+
+    parallel_for_range<Index>(0, nblocks, 1, [=, &combine](Index first, Index last) {
+        for (Index b = first; b < last; b++) {
+            Index len = std::min(block, size - b * block);
+            scan_block(in + b * block, out + b * block, len, blockSums[b], combine, mode);
+        }
+    });
+}
+
+} // namespace internal
+
+/*
+ * Calls body(first, last) on disjoint subranges [first, last) covering all of
+ * [begin, end), in parallel. Subranges hold at most grain indices, except when
+ * grain is less than one, which is taken as one.
+ *
+ * The range is split lazily: a worker splits its range in half, leaving the
+ * upper half for thieves, only while its own deque is empty, and otherwise
+ * works through its range one grain at a time. Work so spreads through the
+ * workers in a logarithmic number of steals, without ever creating a task
+ * per grain up front.
+ *
+ * Called from inside a task, the subranges become "children" of that task,
+ * and parallel_for() waits for all of the task's children, like Task::wait().
+ * Called from outside any task, the scheduler to run on must be given, and
+ * parallel_for() waits for all of its root tasks, like Scheduler::wait().
+ */
+template<typename Index, typename Body>
+void parallel_for(Index begin, Index end, Index grain, const Body& body, Scheduler* scheduler = nullptr) {
+    if (end <= begin) {
+        return;
+    }
+    if (grain < 1) {
+        grain = 1;
+    }
+
+    if (internal::Worker::get_current() != nullptr) {
+        internal::parallel_for_range(begin, end, grain, body);
+        return;
+    }
+
+    // not on a worker, start splitting from a root task
+    assert(scheduler != nullptr && "called outside a task, so a scheduler must be given");
+    scheduler->spawn([=, &body] { internal::parallel_for_range(begin, end, grain, body); });
+    scheduler->wait();
+}
+
+/*
+ * Reduces [begin, end) to a single value in parallel: map(first, last) reduces
+ * a subrange [first, last) of at most grain indices to a partial result of
+ * type T, and combine(a, b) merges two partial results, a covering indices
+ * before those of b. combine must be associative with identity as its
+ * neutral element, it need not be commutative. An empty range reduces to
+ * identity.
+ *
+ * The range is split lazily, like parallel_for(), and every split joins its
+ * two halves' partial results directly, so the reduction forms a tree over
+ * per-task partial results, taking O(n/p + log p) time on p workers without
+ * any shared intermediate array.
+ *
+ * Called from inside a task it waits for all of that task's children, and
+ * from outside any task for all root tasks of the given scheduler, like
+ * parallel_for().
+ */
+template<typename T, typename Index, typename Map, typename Combine>
+T parallel_reduce(Index begin, Index end, Index grain, const T& identity,
+                  const Map& map, const Combine& combine, Scheduler* scheduler = nullptr) {
+    if (end <= begin) {
+        return identity;
+    }
+    if (grain < 1) {
+        grain = 1;
+    }
+
+    if (internal::Worker::get_current() != nullptr) {
+        return internal::parallel_reduce_range(begin, end, grain, identity, map, combine);
+    }
+
+    // not on a worker, start splitting from a root task
+    assert(scheduler != nullptr && "called outside a task, so a scheduler must be given");
+    T result = identity;
+    scheduler->spawn([=, &result, &identity, &map, &combine] {
+        result = internal::parallel_reduce_range(begin, end, grain, identity, map, combine);
+    });
+    scheduler->wait();
+
+    return result;
+}
+
+/*
+ * Prefix sums of in[0, size) in parallel: with INCLUSIVE_SCAN, out[i] holds
+ * in[0] up to in[i] combined, with EXCLUSIVE_SCAN in[0] up to in[i-1], and
+ * identity for out[0]. combine must be associative with identity as its
+ * neutral element, it need not be commutative. out may be the same array
+ * as in.
+ *
+ * The scan takes two passes over the array, in blocks of grain elements: an
+ * up-sweep reducing every block, and after scanning the much smaller array
+ * of block sums, a down-sweep scanning every block from its offset. Both
+ * in-block kernels are plain loops over contiguous memory, which leaves the
+ * compiler free to vectorize the up-sweep.
+ *
+ * Called from inside a task it waits for all of that task's children, and
+ * from outside any task for all root tasks of the given scheduler, like
+ * parallel_for().
+ */
+template<typename T, typename Index, typename Combine>
+void parallel_scan(const T* in, T* out, Index size, Index grain, const T& identity, const Combine& combine,
+                   int mode = INCLUSIVE_SCAN, Scheduler* scheduler = nullptr) {
+    if (size <= 0) {
+        return;
+    }
+    if (grain < 1) {
+        grain = 1;
+    }
+
+    if (internal::Worker::get_current() != nullptr) {
+        internal::parallel_scan_blocks(in, out, size, grain, identity, combine, mode);
+        return;
+    }
+
+    // not on a worker, run both passes from a root task
+    assert(scheduler != nullptr && "called outside a task, so a scheduler must be given");
+    scheduler->spawn([=, &identity, &combine] {
+        internal::parallel_scan_blocks(in, out, size, grain, identity, combine, mode);
+    });
+    scheduler->wait();
+}
+
+} // namespace WSDS
+
+#endif // _WSDS_PARALLEL_DEFINE
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#ifndef _WSDS_RNG_DEFINE
+#define _WSDS_RNG_DEFINE
+
+#include <atomic>
+#include <stdint.h>
+
+namespace WSDS {
+
+/*
+ * Internal data structures and functions not expected to be used
+ * by user applications utilizing the WSDS user-level scheduler.
+ */
+namespace internal {
+
+/*
+ * A small, fast xorshift64* random number generator. Every thread gets its
+ * own through XorShift::local(), so picking random victims or workers never
+ * shares any state, or a cache line, between threads. Not suitable for
+ * anything needing statistical quality beyond spreading load.
+ */
+class XorShift {
+
+public:
+    XorShift(uint64_t seed) {
+        // state must never be zero
+        this->state = seed != 0 ? seed : 0x9e3779b97f4a7c15ull;
+    }
+
+    // next 32 random bits
+    uint32_t next(void) {
+        this->state ^= this->state >> 12;
+        this->state ^= this->state << 25;
+        this->state ^= this->state >> 27;
+        return (this->state * 0x2545f4914f6cdd1dull) >> 32;
+    }
+
+    // random integer in [0, n), n must be positive
+    int next_int(int n) {
+        // multiply and shift instead of a modulo
+        return ((uint64_t)this->next() * (uint32_t)n) >> 32;
+    }
+
+    // get the generator of the calling thread
+    static XorShift& local(void) {
+        thread_local XorShift rng(next_seed());
+        return rng;
+    }
+
+private:
+    uint64_t state;
+
+    // distinct seed for every thread, spread out by a splitmix64 step
+    static uint64_t next_seed(void) {
+        static std::atomic<uint64_t> counter(0);
+        uint64_t z = counter.fetch_add(1, std::memory_order_relaxed) * 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+}; // class XorShift
+
+} // namespace internal
+
+} // namespace WSDS
+
+#endif // _WSDS_RNG_DEFINE
@@ -6,9 +6,14 @@
 #define _WSDS_SCHEDULER_DEFINE
 
 #include <iostream>
-#include <random>
 #include <chrono>
 #include <limits.h>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include "task.h"
+#include "topology.h"
 #include "worker.h"
 
 namespace WSDS {
@@ -21,13 +26,17 @@ namespace internal {
 
 /*
  * WorkerData struct required by the current Scheduler implementation in order
- * to manage the state of workers and their data.
+ * to manage the state of workers and their data. Entries are allocated as a
+ * contiguous array, so each is cache line aligned to keep the ready and
+ * started flags of neighbouring workers from false sharing.
  */
-typedef struct _WorkerData  {
+typedef struct alignas(CACHE_LINE_SIZE) _WorkerData  {
     std::thread* thr;
     Worker* worker;
     std::atomic_bool ready;
     std::atomic_bool started;
+    std::atomic_int cpu;  // CPU the worker is pinned to, -1 if not pinned
+    std::atomic_int node; // NUMA node of that CPU, -1 if pinning failed
 } WorkerData;
 
 } // namespace internal
@@ -39,35 +48,82 @@ typedef struct _WorkerData  {
  * result in a number of worker threads equivalent to the maximum available
  * hardware. Once setup, user applications should use the scheduler's
  * spawn(Task* task) and wait() functions to "schedule" and process a root task.
+ *
+ * Workers may optionally be pinned to CPUs, either packed tightly onto as few
+ * cores and NUMA nodes as possible (PIN_COMPACT), or spread out over all nodes
+ * and cores (PIN_SCATTER). Pinned workers steal from workers on their own NUMA
+ * node before going to a remote one.
  */
 class Scheduler {
 
 public:
-    Scheduler(int nworkers, int workerAlg = WORK_STEALING);
+    Scheduler(int nworkers, int workerAlg = WORK_STEALING, int pinning = NO_PINNING);
     ~Scheduler();
 
     // schedules the root task for computation by the workers
     void spawn(Task* rootTask);
 
+    // schedules a root task running f for computation by the workers
+    template<typename F, typename = typename std::enable_if<
+        !std::is_convertible<F, Task*>::value>::type>
+    void spawn(F&& f) {
+        this->spawn(Task::create_lambda(std::forward<F>(f)));
+    }
+
     // called by the user application to wait for computation of all
     // root tasks to finish
     void wait(void);
 
+    // called by a worker once it has finished a root task
+    void finish_root_task(void);
+
     // choose the next worker to get a task based on worker algorithm,
     // not needed when using work stealing
     internal::Worker* next_worker(bool forceRandom = false);
 
-    std::default_random_engine generator;
-    std::uniform_int_distribution<int> distribution;
+    // hand a task to whichever worker next runs out of local work, used
+    // with work stealing where only a deque's owner may push to it
+    void inject_task(Task* task);
+
+    // take the oldest injected task, or nullptr if there is none
+    Task* take_injected_task(void);
+
+    // are there any injected tasks waiting to be picked up?
+    bool has_injected_tasks(void) { return this->ninjected.load() > 0; }
+
+    // called after making new work visible, wakes one parked worker
+    // if there are any
+    void notify_work(void);
+
+    // snapshot of what all workers have done since they were created or
+    // the stats were last reset, summed up over the workers
+    Stats stats(void);
+
+    // zero the stats of all workers, by remembering the current snapshot
+    // and subtracting it from later ones
+    void reset_stats(void);
+
+    // called by a worker as it parks, and once it is woken again
+    void add_sleeper(void) { this->nsleepers.fetch_add(1); }
+    void remove_sleeper(void) { this->nsleepers.fetch_sub(1); }
 
 private:
     int nworkers;
     internal::WorkerData* workers;
     internal::Worker* masterWorker;
     std::vector<Task*> rootTasks;
+    int pendingRoots; // root tasks not yet finished
+    std::mutex rootsMutex;
+    std::condition_variable rootsCV;
     int workerAlg;
-    int roundRobinIndex;
-    std::mutex roundRobinMutex;
+    int pinning;
+    alignas(internal::CACHE_LINE_SIZE) std::atomic<unsigned int> roundRobinIndex;
+    std::deque<Task*> injectedTasks;
+    std::atomic<int> ninjected;
+    std::mutex injectedMutex;
+    alignas(internal::CACHE_LINE_SIZE) std::atomic<int> nsleepers; // parked workers
+    std::atomic<int> wakeIndex; // where the next search for a parked worker starts
+    Stats statsBaseline; // snapshot taken by the last reset_stats()
 
     // create and start all worker threads if not already started
     void start_workers(void);
@@ -87,7 +143,13 @@ private:
     // prepare worker with given worker id
     void create_worker(int id, int nvictims);
 
-    // determine worker with smallest number of waiting ready tasks
+#ifdef WSDS_TRACE
+    // write the traces of all workers to the trace file
+    void write_trace(void);
+#endif
+
+    // determine a worker with few waiting ready tasks, the less loaded of
+    // two sampled at random
     internal::Worker* worker_with_smallest_deque(void);
 
 #ifdef _UNIT_TESTING
@@ -95,6 +157,8 @@ public:
     int get_nworkers() { return this->nworkers; }
     internal::WorkerData* get_workers() { return this->workers; }
     int get_workerAlg() { return this->workerAlg; }
+    int get_pinning() { return this->pinning; }
+    int get_nsleepers() { return this->nsleepers.load(); }
     Task* get_rootTask(unsigned int i) {
         if (i < this->rootTasks.size()) {
             return this->rootTasks[i];
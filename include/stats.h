@@ -0,0 +1,127 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#ifndef _WSDS_STATS_DEFINE
+#define _WSDS_STATS_DEFINE
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+namespace WSDS {
+
+/*
+ * Stats struct holds a snapshot of what the workers of a scheduler have been
+ * doing, summed up over all workers, see Scheduler::stats().
+ */
+typedef struct _Stats {
+    long tasksExecuted;   // tasks processed by a worker
+    long tasksSpawned;    // tasks spawned from inside another task
+    long stealAttempts;   // victim deques probed, including retries
+    long steals;          // probes that came back with a task
+    long abortedSteals;   // probes that lost the race for a task
+    long waitIterations;  // rounds of wait_loop spent waiting on children
+    long foreignRepushes; // tasks a deep waiting worker handed on to others
+    double idleTime;      // seconds spent in work_loop without any work
+
+    // pretty print the stats, one per line
+    void print(std::ostream& out) const {
+        out << "  tasks executed:   " << this->tasksExecuted << std::endl;
+        out << "  tasks spawned:    " << this->tasksSpawned << std::endl;
+        out << "  steal attempts:   " << this->stealAttempts << std::endl;
+        out << "  steals:           " << this->steals << std::endl;
+        out << "  aborted steals:   " << this->abortedSteals << std::endl;
+        out << "  wait iterations:  " << this->waitIterations << std::endl;
+        out << "  foreign repushes: " << this->foreignRepushes << std::endl;
+        out << "  idle time:        " << this->idleTime << " s" << std::endl;
+    }
+
+    // take off what an earlier snapshot had already counted
+    void subtract(const _Stats& baseline) {
+        this->tasksExecuted -= baseline.tasksExecuted;
+        this->tasksSpawned -= baseline.tasksSpawned;
+        this->stealAttempts -= baseline.stealAttempts;
+        this->steals -= baseline.steals;
+        this->abortedSteals -= baseline.abortedSteals;
+        this->waitIterations -= baseline.waitIterations;
+        this->foreignRepushes -= baseline.foreignRepushes;
+        this->idleTime -= baseline.idleTime;
+    }
+} Stats;
+
+/*
+ * Internal data structures and functions not expected to be used
+ * by user applications utilizing the WSDS user-level scheduler.
+ */
+namespace internal {
+
+/*
+ * Counters behind the Stats of a single worker. Only the worker itself ever
+ * counts, so plain relaxed loads and stores suffice and no atomic read-modify-
+ * write is needed, while other threads may still read them at any time. The
+ * counters are never zeroed while the worker runs, a store from another thread
+ * would race with the worker's own, so the scheduler subtracts a snapshot
+ * instead, see Scheduler::reset_stats().
+ *
+ * While the worker is idle, idleNanos holds its idle time so far minus the
+ * steady clock time its current idle stretch started, which is negative, so a
+ * snapshot can credit the stretch up to now without the worker's help.
+ */
+typedef struct _WorkerCounters {
+    std::atomic<long> tasksExecuted;
+    std::atomic<long> tasksSpawned;
+    std::atomic<long> stealAttempts;
+    std::atomic<long> steals;
+    std::atomic<long> abortedSteals;
+    std::atomic<long> waitIterations;
+    std::atomic<long> foreignRepushes;
+    std::atomic<long> idleNanos;
+
+    // steady clock time in nanoseconds
+    static long now_nanos(void) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // add n to one of the counters, only called by the owning worker
+    static void add(std::atomic<long>& counter, long n = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // add the counters to a stats snapshot
+    void add_to(Stats& stats) const {
+        stats.tasksExecuted += this->tasksExecuted.load(std::memory_order_relaxed);
+        stats.tasksSpawned += this->tasksSpawned.load(std::memory_order_relaxed);
+        stats.stealAttempts += this->stealAttempts.load(std::memory_order_relaxed);
+        stats.steals += this->steals.load(std::memory_order_relaxed);
+        stats.abortedSteals += this->abortedSteals.load(std::memory_order_relaxed);
+        stats.waitIterations += this->waitIterations.load(std::memory_order_relaxed);
+        stats.foreignRepushes += this->foreignRepushes.load(std::memory_order_relaxed);
+
+        long idleNanos = this->idleNanos.load(std::memory_order_relaxed);
+        if (idleNanos < 0) {
+            // idle right now, count the current stretch up to now
+            idleNanos += now_nanos();
+        }
+        stats.idleTime += idleNanos / 1e9;
+    }
+
+    // zero all counters, only before the worker starts
+    void reset(void) {
+        this->tasksExecuted.store(0, std::memory_order_relaxed);
+        this->tasksSpawned.store(0, std::memory_order_relaxed);
+        this->stealAttempts.store(0, std::memory_order_relaxed);
+        this->steals.store(0, std::memory_order_relaxed);
+        this->abortedSteals.store(0, std::memory_order_relaxed);
+        this->waitIterations.store(0, std::memory_order_relaxed);
+        this->foreignRepushes.store(0, std::memory_order_relaxed);
+        this->idleNanos.store(0, std::memory_order_relaxed);
+    }
+} WorkerCounters;
+
+} // namespace internal
+
+} // namespace WSDS
+
+#endif // _WSDS_STATS_DEFINE
@@ -6,14 +6,24 @@
 #define _WSDS_TASK_DEFINE
 
 #include <iostream>
-#include <vector>
-#include <mutex>
-#include <condition_variable>
+#include <atomic>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include "arena.h"
 #include "worker.h"
 
 namespace WSDS {
 
-namespace internal { class Worker; } // forward declaration, defined elsewhere
+namespace internal {
+
+class Worker; // forward declaration, defined elsewhere
+
+template<typename F>
+class LambdaTask; // forward declaration, defined below
+
+} // namespace internal
 
 /*
  * A singular task to be processed sequentially by a worker; however, execution
@@ -24,6 +34,16 @@ namespace internal { class Worker; } // forward declaration, defined elsewhere
  * User applications should extend this Task class in order to define their
  * own computive tasks. The execute() function is the computation to be done,
  * and must be defined by the extending class.
+ *
+ * Tasks may be allocated with new and delete like any other object, but
+ * applications spawning many small tasks should prefer Task::create<T>(...)
+ * and Task::recycle(task), which reuse task memory from a per-worker arena.
+ * Tasks created this way must be recycled before the scheduler is deleted.
+ *
+ * Small units of work need no Task subclass at all: spawn() also accepts any
+ * callable, e.g. a lambda, which is stored inline in an arena allocated task
+ * and recycled automatically once it has finished. Such a task implicitly
+ * waits for all the tasks it spawned itself before it finishes.
  */
 class Task {
 
@@ -31,6 +51,27 @@ public:
     Task();
     virtual ~Task();
 
+    // create a task of type T from the arena of the calling worker
+    template<typename T, typename... Args>
+    static T* create(Args&&... args) {
+        static_assert(std::is_base_of<Task, T>::value, "T must extend WSDS::Task");
+        static_assert(alignof(T) <= internal::TaskArena::ALIGNMENT, "T is over-aligned");
+        void* mem = internal::TaskArena::allocate(sizeof(T));
+        return new (mem) T(std::forward<Args>(args)...);
+    }
+
+    // destroy a task made by create() and return its memory for reuse
+    static void recycle(Task* task);
+
+    // create a task running f, which is recycled by the worker once it
+    // has finished, so it must be spawned and not be used afterwards
+    template<typename F>
+    static Task* create_lambda(F&& f) {
+        Task* task = create<internal::LambdaTask<typename std::decay<F>::type>>(std::forward<F>(f));
+        task->state.store(RECYCLE, std::memory_order_relaxed);
+        return task;
+    }
+
     // execute() is task computation function that must be
     // defined by extending class
     virtual void execute() = 0;
@@ -41,13 +82,21 @@ public:
     // spawns a new "child" task
     void spawn(Task* task);
 
+    // spawns a new "child" task running f
+    template<typename F, typename = typename std::enable_if<
+        !std::is_convertible<F, Task*>::value>::type>
+    void spawn(F&& f) {
+        this->spawn(create_lambda(std::forward<F>(f)));
+    }
+
     // this task shall wait for all "children" tasks to finish computation;
     // in the meantime, this task's worker may choose to process another
     // ready tasks waiting to be processed, which may or may not be a "child"
     // task
     void wait(void);
 
-    // is the task in a ready state for processing?
+    // is the task in a ready state for processing? true once all spawned
+    // "children" tasks have finished
     bool is_ready(void);
 
     // is the task computation finished?
@@ -62,19 +111,56 @@ public:
     // returns unique task id
     int get_id();
 
-    std::mutex finishedMutex;
-    std::condition_variable finishedCV;
-
 private:
+    // flags set in the state word once the task has finished, and if the
+    // worker recycles the task afterwards, the remaining bits count the
+    // spawned "children" tasks that have not yet finished
+    static constexpr int FINISHED = 1 << 30;
+    static constexpr int RECYCLE = 1 << 29;
+    static constexpr int PENDING_MASK = RECYCLE - 1;
+
     internal::Worker* worker;
     Task* parent;
-    std::vector<Task*> children;
-    bool finished;
-    bool ready;
+    std::atomic<int> state;
     int id;
 
 }; // class Task
 
+/*
+ * Internal data structures and functions not expected to be used
+ * by user applications utilizing the WSDS user-level scheduler.
+ */
+namespace internal {
+
+/*
+ * A task running a callable stored inline, see Task::spawn(F&& f).
+ */
+template<typename F>
+class LambdaTask : public Task {
+
+public:
+    template<typename G>
+    LambdaTask(G&& func) : func(std::in_place, std::forward<G>(func)) {}
+
+    void execute() {
+        (*this->func)();
+
+        // nobody else can wait on this task, and it is recycled right after
+        // finishing, so its children must be done by then
+        this->wait();
+
+        // whoever joins the task may return as soon as it finishes, taking
+        // anything the captures refer to with it, so destroy them first
+        this->func.reset();
+    }
+
+private:
+    std::optional<F> func;
+
+}; // class LambdaTask
+
+} // namespace internal
+
 } // namespace WSDS
 
 #endif // _WSDS_TASK_DEFINE
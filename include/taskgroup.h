@@ -0,0 +1,74 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#ifndef _WSDS_TASKGROUP_DEFINE
+#define _WSDS_TASKGROUP_DEFINE
+
+#include <cassert>
+#include "scheduler.h"
+#include "task.h"
+#include "worker.h"
+
+namespace WSDS {
+
+/*
+ * Spawns callables as tasks, and joins them again with sync(). Inside a task,
+ * the callables are spawned as "children" of the task being processed, and
+ * sync() waits for all of that task's children, like Task::wait(). Outside of
+ * any task, e.g. in main, the group needs a scheduler, the callables become
+ * its root tasks, and sync() waits for all of its root tasks, like
+ * Scheduler::wait(). A group syncs once more when it goes out of scope.
+ *
+ *     long x, y;
+ *     WSDS::TaskGroup group;
+ *     group.spawn([&] { x = fib(n-1); });
+ *     group.spawn([&] { y = fib(n-2); });
+ *     group.sync();
+ *     return x + y;
+ */
+class TaskGroup {
+
+public:
+    TaskGroup(Scheduler* scheduler = nullptr) {
+        internal::Worker* worker = internal::Worker::get_current();
+        this->task = (worker != nullptr) ? worker->get_current_task() : nullptr;
+        this->scheduler = scheduler;
+        assert((this->task != nullptr || this->scheduler != nullptr) &&
+               "created outside a task, so a scheduler must be given");
+    }
+
+    ~TaskGroup() {
+        this->sync();
+    }
+
+    // spawn a task running f
+    template<typename F>
+    void spawn(F&& f) {
+        if (this->task != nullptr) {
+            this->task->spawn(std::forward<F>(f));
+        }
+        else {
+            this->scheduler->spawn(std::forward<F>(f));
+        }
+    }
+
+    // wait for all spawned tasks to finish
+    void sync(void) {
+        if (this->task != nullptr) {
+            this->task->wait();
+        }
+        else if (this->scheduler != nullptr) {
+            this->scheduler->wait();
+        }
+    }
+
+private:
+    Task* task; // task being processed by the calling worker, if any
+    Scheduler* scheduler;
+
+}; // class TaskGroup
+
+} // namespace WSDS
+
+#endif // _WSDS_TASKGROUP_DEFINE
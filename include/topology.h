@@ -0,0 +1,79 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#ifndef _WSDS_TOPOLOGY_DEFINE
+#define _WSDS_TOPOLOGY_DEFINE
+
+#include <string>
+#include <vector>
+
+namespace WSDS {
+
+static constexpr int NO_PINNING = 0;  // workers float freely between CPUs
+static constexpr int PIN_COMPACT = 1; // fill a core, then a node, then the next
+static constexpr int PIN_SCATTER = 2; // spread across nodes, then cores, then SMT threads
+
+/*
+ * Internal data structures and functions not expected to be used
+ * by user applications utilizing the WSDS user-level scheduler.
+ */
+namespace internal {
+
+/*
+ * CpuInfo struct describes where a single logical CPU sits in the machine.
+ */
+typedef struct _CpuInfo {
+    int cpu;     // logical CPU number, as used for affinity masks
+    int node;    // NUMA node
+    int package; // physical socket
+    int core;    // core id, unique within the package
+} CpuInfo;
+
+/*
+ * The CPU and NUMA layout of the machine, read from /sys/devices/system/cpu
+ * so that no external library is needed. Used by the scheduler to pin its
+ * workers to CPUs, and to tell which workers share a NUMA node. If the
+ * layout can not be read, every CPU is assumed to be its own core on node 0.
+ * Only the CPUs in the process's affinity mask are kept, so that under
+ * taskset or a cgroup cpuset, e.g. a Slurm job, workers are only ever placed
+ * on CPUs they may run on.
+ */
+class Topology {
+
+public:
+    Topology();
+    Topology(std::vector<CpuInfo> cpus);
+
+    // choose a CPU for each of nworkers workers following the given
+    // pinning policy, wrapping around if there are more workers than CPUs
+    std::vector<CpuInfo> placement(int nworkers, int pinning);
+
+    // pin the calling thread to the given CPU, returns false on failure
+    static bool pin_current_thread(int cpu);
+
+    // get the number of logical CPUs
+    int get_ncpus(void) { return this->cpus.size(); }
+
+private:
+    std::vector<CpuInfo> cpus;
+
+    // read the layout of all online CPUs
+    void read_sysfs(void);
+
+    // drop the CPUs the calling process may not run on
+    void restrict_to_affinity(void);
+
+    // read the NUMA node of the given CPU
+    static int read_node(int cpu);
+
+    // read a single integer from a sysfs file, or fallback if unreadable
+    static int read_int(std::string path, int fallback);
+
+}; // class Topology
+
+} // namespace internal
+
+} // namespace WSDS
+
+#endif // _WSDS_TOPOLOGY_DEFINE
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#ifndef _WSDS_TRACE_DEFINE
+#define _WSDS_TRACE_DEFINE
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include "config.h"
+
+/*
+ * Tracing hooks, which compile out to nothing unless WSDS_TRACE is defined.
+ * The worker argument is a Worker*, whose tracer records the event.
+ */
+#ifdef WSDS_TRACE
+#define WSDS_TRACE_TASK_BEGIN(worker, taskId) (worker)->get_tracer()->task_begin(taskId)
+#define WSDS_TRACE_TASK_END(worker, taskId) (worker)->get_tracer()->task_end(taskId)
+#define WSDS_TRACE_STEAL_START(name) uint64_t name = WSDS::internal::Tracer::now()
+#define WSDS_TRACE_STEAL(worker, start, victimId) (worker)->get_tracer()->steal(start, victimId)
+#else
+#define WSDS_TRACE_TASK_BEGIN(worker, taskId) ((void)0)
+#define WSDS_TRACE_TASK_END(worker, taskId) ((void)0)
+#define WSDS_TRACE_STEAL_START(name) ((void)0)
+#define WSDS_TRACE_STEAL(worker, start, victimId) ((void)0)
+#endif
+
+namespace WSDS {
+
+/*
+ * Internal data structures and functions not expected to be used
+ * by user applications utilizing the WSDS user-level scheduler.
+ */
+namespace internal {
+
+/*
+ * TraceEvent struct is a single event recorded by a Tracer.
+ */
+typedef struct _TraceEvent {
+    uint64_t time;     // ns on the steady clock
+    uint64_t duration; // ns, steals only
+    int id;            // task id, or victim worker id for steals
+    int type;          // one of the Tracer event types
+} TraceEvent;
+
+/*
+ * Records the events of a single worker into a fixed size ring buffer, so
+ * only the most recent events are kept once it fills up. Only the owning
+ * worker records, so no synchronization is needed until the buffer is
+ * written out after the worker has stopped.
+ */
+class Tracer {
+
+public:
+    Tracer(int workerId, size_t capacity = DEFAULT_CAPACITY);
+
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+    static constexpr int TASK_BEGIN = 0;
+    static constexpr int TASK_END = 1;
+    static constexpr int STEAL = 2;
+
+    // record the start and end of processing a task
+    void task_begin(int taskId) { this->record(now(), 0, taskId, TASK_BEGIN); }
+    void task_end(int taskId) { this->record(now(), 0, taskId, TASK_END); }
+
+    // record a successful steal from the given victim that started at start
+    void steal(uint64_t start, int victimId) { this->record(start, now() - start, victimId, STEAL); }
+
+    // current time in ns on the steady clock
+    static uint64_t now(void) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // write the events of all tracers as a Chrome trace JSON document
+    static void write_json(std::ostream& out, std::vector<Tracer*>& tracers);
+
+    // get the number of events kept in the ring buffer
+    size_t get_nevents(void) { return this->wrapped ? this->events.size() : this->next; }
+
+private:
+    int workerId;
+    std::vector<TraceEvent> events;
+    size_t next; // slot the next event goes to
+    bool wrapped; // older events have been overwritten
+
+    // add an event to the ring buffer, overwriting the oldest when full
+    void record(uint64_t time, uint64_t duration, int id, int type) {
+        this->events[this->next] = {time, duration, id, type};
+        if (++this->next == this->events.size()) {
+            this->next = 0;
+            this->wrapped = true;
+        }
+    }
+
+    // get the i-th oldest event kept
+    TraceEvent& get_event(size_t i) {
+        return this->events[this->wrapped ? (this->next + i) % this->events.size() : i];
+    }
+
+}; // class Tracer
+
+} // namespace internal
+
+} // namespace WSDS
+
+#endif // _WSDS_TRACE_DEFINE
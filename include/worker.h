@@ -6,11 +6,17 @@
 #define _WSDS_WORKER_DEFINE
 
 #include <iostream>
-#include <random>
 #include <stdlib.h>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <queue>
+#include "arena.h"
+#include "config.h"
 #include "deque.h"
+#include "rng.h"
+#include "stats.h"
+#include "trace.h"
 
 namespace WSDS {
 
@@ -44,15 +50,23 @@ class Deque; // forward declaration, defined elsewhere
  * assign a task to. This will always be a "root" task, which in most cases
  * will spawn many children tasks that will inevitably be "stolen" by the
  * other non-master workers to maximize parallel computation.
+ *
+ * Workers are cache line aligned, and the members written by other threads
+ * are kept on cache lines apart from the ones only the worker itself uses.
  */
-class Worker {
+class alignas(CACHE_LINE_SIZE) Worker {
 
 public:
     Worker(int id, int nvictims, Scheduler* scheduler, int workerAlg = WORK_STEALING);
     ~Worker();
 
-    // add a "victim" worker to cache of potential victims
-    void add_victim(Worker* victim);
+    // add a "victim" worker to cache of potential victims, local
+    // victims share this worker's NUMA node
+    void add_victim(Worker* victim, bool local = false);
+
+    // treat all victims as remote, for a worker that is not on the NUMA
+    // node its local victims were chosen for
+    void clear_local_victims(void);
 
     // add a task to the worker's ready pool
     void add_ready_task(Task* task, bool forceSelf = false, bool forceNotSelf = false);
@@ -60,37 +74,126 @@ public:
     // indicate this worker should be stopped
     void stop(void);
 
+    // wake the worker if it is parked, returns false if it was not
+    bool wake(void);
+
     // the main work loop of the worker
     void work_loop(void);
 
     // secondary work loop for when the task being processed calls a wait()
     // and can not proceed until all its children tasks have finished
-    void wait_loop(void);
+    void wait_loop(Task* waitingTask);
+
+    // maximum number of nested wait loops before a worker stops running
+    // unrelated tasks on top of the task it is waiting in
+    static constexpr int MAX_WAIT_DEPTH = 64;
+
+    // bounds on the number of rounds an idle worker spins looking for work
+    // before parking, adapted to how often spinning pays off
+    static constexpr int MIN_IDLE_SPINS = 16;
+    static constexpr int MAX_IDLE_SPINS = 1024;
+
+    // smallest victim deque a thief takes a batch of tasks from
+    static constexpr int STEAL_BATCH_THRESHOLD = 4;
+
+    // failed steal attempts per local victim before trying a remote one
+    static constexpr int LOCAL_STEAL_ATTEMPTS = 2;
 
-    // get the current size of the reqdy deque (number of waiting ready tasks)
+    // victims tried per steal, and most yields between steals that found
+    // every victim empty
+    static constexpr int STEAL_SWEEP = 4;
+    static constexpr int MAX_STEAL_BACKOFF = 32;
+
+    // get the current size of the ready deque (number of waiting ready
+    // tasks), only approximate while other threads push or pop
     int get_ready_deque_size(void);
 
-    std::mutex dequeMutex; // not needed in work stealing alg
-    std::default_random_engine generator;
-    std::uniform_int_distribution<int> distribution;
+    // get the scheduler the worker belongs to
+    Scheduler* get_scheduler(void) { return this->scheduler; }
+
+    // get the worker running on the calling thread, nullptr if none
+    static Worker* get_current(void) { return current; }
+
+    // get the task the worker is currently processing
+    Task* get_current_task(void) { return this->assignedTask; }
+
+    // count a task spawned by the task this worker is processing
+    void count_spawn(void) { WorkerCounters::add(this->counters.tasksSpawned); }
+
+    // add this worker's counters to a stats snapshot
+    void add_stats(Stats& stats) { this->counters.add_to(stats); }
+
+#ifdef WSDS_TRACE
+    // get the tracer recording this worker's events
+    Tracer* get_tracer(void) { return this->tracer; }
+#endif
+
+    alignas(CACHE_LINE_SIZE) std::mutex dequeMutex; // not used in work stealing alg
 
 private:
+    static inline thread_local Worker* current = nullptr;
+
     int id;
     Task* assignedTask;
+    long assignedBase; // ready deque bottom when assignedTask started
+    int waitDepth;
     Deque* readyDeq;
+    TaskArena* arena;
     int nvictims;
+    int nlocalVictims; // local victims come first in victimDeqs
+    int localMisses; // failed local steals since the last remote attempt
+    int lastVictim; // victim of the last successful steal, -1 if none
+    int stealBackoff; // yields the next time no work is found
     Deque** victimDeqs;
-    std::atomic_bool stopped;
     int workerAlg;
     Scheduler* scheduler;
+    int idleSpins;
+    alignas(CACHE_LINE_SIZE) WorkerCounters counters; // only written by this worker
+#ifdef WSDS_TRACE
+    Tracer* tracer;
+#endif
+    alignas(CACHE_LINE_SIZE) std::atomic_bool stopped; // written by the scheduler
+
+    // parking state, written by whoever wakes the worker
+    alignas(CACHE_LINE_SIZE) std::atomic_bool sleeping;
+    bool wakeSignal;
+    std::mutex sleepMutex;
+    std::condition_variable sleepCV;
+
+    // park the worker until woken, unless work turns up meanwhile
+    void park(void);
+
+    // is there any work this worker could pick up?
+    bool has_visible_work(void);
+
+    // remove and return a task from the bottom of the worker's own ready deque
+    Task* pop_ready_task(void);
+
+    // process a task, keeping track of where its frame starts in the deque
+    void run_task(Task* task);
+
+    // does task originate from ancestor (child, grandchild, ...)?
+    bool originates_from(Task* task, Task* ancestor);
 
     // attempt to steal a task from a "victim"
     Task* steal_task(void);
 
+    // yield the core for a while after finding no work, twice as long as
+    // the last time, up to MAX_STEAL_BACKOFF yields
+    void back_off(void);
+
+    // choose a random victim, preferring the ones on our own NUMA node
+    int pick_victim(void);
+
+    // attempt to steal a task from the given victim, retrying as long as
+    // we only lose races for its tasks
+    Task* steal_from(int index);
+
 #ifdef _UNIT_TESTING
 public:
     int get_id() { return this->id; }
     int get_nvictims() { return this->nvictims; }
+    int get_nlocalVictims() { return this->nlocalVictims; }
     bool get_workerAlg() { return this->workerAlg; }
 #endif
 
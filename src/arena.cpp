@@ -0,0 +1,181 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#include <new>
+#include "arena.h"
+
+namespace WSDS {
+
+/*
+ * Internal data structures and functions not expected to be used
+ * by user applications utilizing the WSDS user-level scheduler.
+ */
+namespace internal {
+
+thread_local TaskArena* TaskArena::current = nullptr;
+
+TaskArena::TaskArena() {
+    for (int i = 0; i < NCLASSES; i++) {
+        this->freeLists[i] = nullptr;
+    }
+    this->slabNext = nullptr;
+    this->slabEnd = nullptr;
+    this->pendingOwner = nullptr;
+    this->pendingHead = nullptr;
+    this->pendingTail = nullptr;
+    this->npending = 0;
+    this->remoteFrees.store(nullptr);
+}
+
+TaskArena::~TaskArena() {
+    // any blocks still handed out are released along with their slabs
+    for (char* slab : this->slabs) {
+        ::operator delete(slab);
+    }
+}
+
+// allocate a block of at least size bytes from the arena of the
+// calling thread, or from the heap if it has none
+void* TaskArena::allocate(size_t size) {
+    size_t total = size + sizeof(BlockHeader);
+    int sizeClass = (total + CLASS_SIZE - 1) / CLASS_SIZE - 1;
+
+    BlockHeader* block;
+    if (current != nullptr && sizeClass < NCLASSES) {
+        block = current->allocate_block(sizeClass);
+    }
+    else {
+        // no arena, or too large for any size class
+        block = static_cast<BlockHeader*>(::operator new(total));
+        block->owner = nullptr;
+        block->sizeClass = -1;
+    }
+
+    return block + 1;
+}
+
+// return a block to the arena it was allocated from
+void TaskArena::release(void* ptr) {
+    BlockHeader* block = static_cast<BlockHeader*>(ptr) - 1;
+    TaskArena* owner = block->owner;
+
+    if (owner == nullptr) {
+        ::operator delete(block);
+    }
+    else if (owner == current) {
+        // local free, straight back onto the owner's free list
+        block->next() = owner->freeLists[block->sizeClass];
+        owner->freeLists[block->sizeClass] = block;
+    }
+    else if (current != nullptr) {
+        // cross-thread free from a worker, batch it up for the owner
+        current->defer_release(block);
+    }
+    else {
+        // cross-thread free from a thread without an arena
+        owner->push_remote_frees(block, block);
+    }
+}
+
+// make this the arena of the calling thread, or remove the calling
+// thread's arena if nullptr
+void TaskArena::set_current(TaskArena* arena) {
+    flush_pending();
+    current = arena;
+}
+
+// hand any batched frees of the calling thread back to their owners
+void TaskArena::flush_pending() {
+    TaskArena* arena = current;
+    if (arena == nullptr || arena->npending == 0) {
+        return;
+    }
+
+    arena->pendingOwner->push_remote_frees(arena->pendingHead, arena->pendingTail);
+    arena->pendingOwner = nullptr;
+    arena->pendingHead = nullptr;
+    arena->pendingTail = nullptr;
+    arena->npending = 0;
+}
+
+// allocate a block of the given size class
+BlockHeader* TaskArena::allocate_block(int sizeClass) {
+    if (this->freeLists[sizeClass] == nullptr) {
+        this->drain_remote_frees();
+    }
+
+    BlockHeader* block = this->freeLists[sizeClass];
+    if (block == nullptr) {
+        return this->carve_block(sizeClass);
+    }
+
+    this->freeLists[sizeClass] = block->next();
+    return block;
+}
+
+// carve a new block of the given size class out of the current slab
+BlockHeader* TaskArena::carve_block(int sizeClass) {
+    size_t blockSize = (sizeClass + 1) * CLASS_SIZE;
+
+    if (this->slabNext == nullptr || this->slabNext + blockSize > this->slabEnd) {
+        // the rest of the old slab is simply abandoned
+        char* slab = static_cast<char*>(::operator new(SLAB_SIZE));
+        this->slabs.push_back(slab);
+        this->slabNext = slab;
+        this->slabEnd = slab + SLAB_SIZE;
+    }
+
+    BlockHeader* block = reinterpret_cast<BlockHeader*>(this->slabNext);
+    this->slabNext += blockSize;
+
+    block->owner = this;
+    block->sizeClass = sizeClass;
+    return block;
+}
+
+// move all blocks handed back by other threads onto the free lists
+void TaskArena::drain_remote_frees() {
+    // only the owner takes from the stack, and it takes everything at
+    // once, so there is no ABA problem with concurrent pushes
+    BlockHeader* block = this->remoteFrees.exchange(nullptr, std::memory_order_acquire);
+    while (block != nullptr) {
+        BlockHeader* next = block->next();
+        block->next() = this->freeLists[block->sizeClass];
+        this->freeLists[block->sizeClass] = block;
+        block = next;
+    }
+}
+
+// push a chain of blocks onto this arena's remote free stack
+void TaskArena::push_remote_frees(BlockHeader* head, BlockHeader* tail) {
+    BlockHeader* top = this->remoteFrees.load(std::memory_order_relaxed);
+    do {
+        tail->next() = top;
+    } while (!this->remoteFrees.compare_exchange_weak(top, head,
+                std::memory_order_release, std::memory_order_relaxed));
+}
+
+// batch up a block owned by another arena
+void TaskArena::defer_release(BlockHeader* block) {
+    // a batch only ever holds blocks of a single owner
+    if (this->npending > 0 && this->pendingOwner != block->owner) {
+        flush_pending();
+    }
+
+    if (this->npending == 0) {
+        this->pendingOwner = block->owner;
+        this->pendingTail = block;
+    }
+    block->next() = this->pendingHead;
+    this->pendingHead = block;
+    this->npending++;
+
+    if (this->npending >= BATCH_SIZE) {
+        flush_pending();
+    }
+}
+
+} // namespace internal
+
+} // namespace WSDS
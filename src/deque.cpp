@@ -5,7 +5,9 @@
 /*
  * Deque implementation is originally based on reference pseudocode provided
  * by Arora, Blumofe, and Plaxton in their paper on "Thread Scheduling for
- * Multiprogrammed Multiprocessors".
+ * Multiprogrammed Multiprocessors", and has since been reworked into the
+ * growable circular deque described by Chase and Lev in their paper on
+ * "Dynamic Circular Work-Stealing Deque".
  */
 
 #include "deque.h"
@@ -18,129 +20,201 @@ namespace WSDS {
  */
 namespace internal {
 
+_CircularArray::_CircularArray(long capacity) {
+    this->capacity = capacity;
+    this->slots = new std::atomic<Task*>[capacity];
+}
+
+_CircularArray::~_CircularArray() {
+    delete[] this->slots;
+}
+
+// allocate an array of double the capacity holding tasks [top, bottom)
+_CircularArray* _CircularArray::grow(long top, long bottom) {
+    CircularArray* bigger = new CircularArray(this->capacity * 2);
+    for (long i = top; i < bottom; i++) {
+        bigger->put(i, this->get(i));
+    }
+    return bigger;
+}
+
 Deque::Deque(int id, size_t size) {
     this->id = id;
-    this->size = size; // initial size
-    this->collection = new Task*[size];
-    internal::Age newAge;
-    newAge.tag = 0;
-    newAge.top = 0;
-    this->age.store(newAge);
-    this->bottom.store(0);
+
+    // round initial size up to a power of two so indices can be masked
+    long capacity = 1;
+    while (capacity < (long)size) {
+        capacity <<= 1;
+    }
+
+    this->array.store(new CircularArray(capacity), std::memory_order_relaxed);
+    this->top.store(0, std::memory_order_relaxed);
+    this->bottom.store(0, std::memory_order_relaxed);
 }
 
 Deque::~Deque() {
-    delete[] this->collection;
+    delete this->array.load(std::memory_order_relaxed);
+    for (CircularArray* old : this->retired) {
+        delete old;
+    }
 }
 
 // remove and return a task from the "top" of the deque,
 // only called by work stealers
-Task* Deque::pop_top() {
-    // load original index values
-    internal::Age oldAge;
-    oldAge = this->age.load();
-    int localBot = this->bottom.load();
+Task* Deque::pop_top(bool* aborted) {
+    // load original index values, the fence orders the load of top before
+    // the load of bottom against the owner's fence in pop_bottom()
+    long localTop = this->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long localBot = this->bottom.load(std::memory_order_acquire);
+
+    if (aborted != nullptr) {
+        *aborted = false;
+    }
 
     // check if deque is empty
-    if (localBot <= oldAge.top) {
+    if (localBot <= localTop) {
         return nullptr; // EMPTY
     }
 
-    // collect task from "top" of deque
-    Task* task = this->collection[oldAge.top];
+    // collect task from "top" of deque, acquiring the array pairs with its
+    // release in push_bottom() so a grown array's contents are visible
+    Task* task = this->array.load(std::memory_order_acquire)->get(localTop);
 
-    // attempt to atomically update top with a compare and swap of age
-    internal::Age newAge = oldAge;
-    newAge.top++;
-    if (this->age.compare_exchange_strong(oldAge, newAge)) {
+    // attempt to atomically claim the task with a compare and swap of top
+    if (this->top.compare_exchange_strong(localTop, localTop + 1,
+            std::memory_order_seq_cst, std::memory_order_relaxed)) {
         // atomic compare and swap success
         return task;
     }
 
-    // atomic update failed, age was modified by another work stealer
+    // atomic update failed, top was modified by another work stealer
+    // or by the owner popping the last task
+    if (aborted != nullptr) {
+        *aborted = true;
+    }
     return nullptr; // ABORT
 }
 
+// remove up to half of the tasks (at most maxTasks) from the "top" of
+// the deque, returning the oldest and pushing the rest onto the bottom
+// of into, which must be owned by the calling work stealer
+Task* Deque::pop_top_batch(Deque* into, int maxTasks, bool* aborted) {
+    // size the batch once, from a single look at the victim
+    long localTop = this->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long localBot = this->bottom.load(std::memory_order_acquire);
+
+    long ntasks = (localBot - localTop + 1) / 2;
+    if (ntasks > maxTasks) {
+        ntasks = maxTasks;
+    }
+    if (ntasks <= 0) {
+        if (aborted != nullptr) {
+            *aborted = false;
+        }
+        return nullptr; // EMPTY
+    }
+
+    // IMPORTANT NOTE!
+    // Claiming the whole batch with one CAS of top is not safe, since the
+    // owner's pop_bottom() only uses a CAS for the last task, and could
+    // take tasks from the middle of a range claimed by a stalled thief.
+    // So the tasks are still claimed one at a time, stopping at the first
+    // failure, saving the victim selection and the walk back through the
+    // caller's loop for every task past the first.
+    Task* first = this->pop_top(aborted);
+    if (first == nullptr) {
+        return nullptr; // EMPTY or ABORT
+    }
+
+    // push in steal order, so the youngest is popped first by the thief
+    // and the oldest is stolen first from the thief by others
+    for (long i = 1; i < ntasks; i++) {
+        Task* task = this->pop_top();
+        if (task == nullptr) {
+            break;
+        }
+        into->push_bottom(task);
+    }
+
+    return first;
+}
+
 // add a task to the "bottom" of the deque,
 // only called by the deque owner
 void Deque::push_bottom(Task* task) {
-    // load original bottom index value
-    int localBot = this->bottom.load();
+    // load original index values, only the owner writes bottom and array
+    long localBot = this->bottom.load(std::memory_order_relaxed);
+    long localTop = this->top.load(std::memory_order_acquire);
+    CircularArray* localArray = this->array.load(std::memory_order_relaxed);
+
+    // grow the deque if full, the outgrown array is retired rather than
+    // deleted since work stealers may still be reading from it
+    if (localBot - localTop >= localArray->capacity) {
+        CircularArray* bigger = localArray->grow(localTop, localBot);
+        this->retired.push_back(localArray);
+        this->array.store(bigger, std::memory_order_release);
+        localArray = bigger;
+    }
 
     // add task to deque
-    this->collection[localBot] = task;
-
-    // atomically update bottom index value
-    localBot++;
-    this->bottom.store(localBot);
+    localArray->put(localBot, task);
 
-    // check for deque overflow
-    int bounds = this->size;
-    if (localBot >= bounds) {
-        internal::Age oldAge;
-        oldAge = this->age.load();
-        std::cout << "ERROR: Deque Overflow: bot = " << localBot << ", top = " << oldAge.top << "\n";
-        exit(1);
-    }
+    // update bottom index value, the fence publishes the task to any
+    // work stealer that observes the new bottom
+    std::atomic_thread_fence(std::memory_order_release);
+    this->bottom.store(localBot + 1, std::memory_order_relaxed);
 }
 
 // remove and return a task from the "bottom" of the deque,
 // only called by the deque owner
 Task* Deque::pop_bottom() {
-    // load original bottom index value
-    int localBot = this->bottom.load();
-
-    // check if deque is empty
-    if (localBot == 0) {
+    // update bottom index value,
+    // effectively reserves bottom most task of deque
+    long localBot = this->bottom.load(std::memory_order_relaxed) - 1;
+    CircularArray* localArray = this->array.load(std::memory_order_relaxed);
+    this->bottom.store(localBot, std::memory_order_relaxed);
+
+    // the reservation must be visible before top is read, otherwise a work
+    // stealer and the owner could both take the same task
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long localTop = this->top.load(std::memory_order_relaxed);
+
+    // check if deque was already empty, if so restore bottom
+    if (localBot < localTop) {
+        this->bottom.store(localBot + 1, std::memory_order_relaxed);
         return nullptr;
     }
 
-    // atomically update bottom index value,
-    // effectively removes bottom most task from deque
-    localBot--;
-    this->bottom.store(localBot);
-
-    // collecte removed task
-    Task* task = this->collection[localBot];
-
-    // load original age value, and check if we made deque empty with pop
-    internal::Age oldAge = this->age.load();
-    if (localBot > oldAge.top) {
-        // deque not empty, proceed with return of popped task
+    // collect reserved task
+    Task* task = localArray->get(localBot);
+    if (localBot > localTop) {
+        // deque not empty after the pop, no race with work stealers possible
         return task;
     }
 
-    // deque is now empty after the pop, reset top and bottom, and increment tag
-    this->bottom.store(0);
-    internal::Age newAge;
-    newAge.top = 0;
-    newAge.tag = oldAge.tag + 1;
-
-    // because the deque is now empty localBot should equal old top, unless
-    // the top (and only) task happen to have been stolen during execution
-    // of this function
-    if (localBot == oldAge.top) {
-        if (this->age.compare_exchange_strong(oldAge, newAge)) {
-            // atomic compare and swap success
-            return task;
-        }
+    // this was the last task, so race work stealers for it by claiming
+    // it from the top, the deque is empty afterwards either way
+    if (!this->top.compare_exchange_strong(localTop, localTop + 1,
+            std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        // last task was stolen before we could "atomically" pop it
+        task = nullptr;
     }
-
-    // if here, "bottom" task was also the "top" task, and was stolen before
-    // we could "atomically" pop it
-    this->age.store(newAge);
-    return nullptr;
+    this->bottom.store(localBot + 1, std::memory_order_relaxed);
+    return task;
 }
 
-// get the current number of tasks in the deque
+// get the current number of tasks in the deque, only an estimate when
+// called by anyone but the owner
 int Deque::get_num_tasks(void) {
-    int localBot = this->bottom.load();
-    internal::Age oldAge = this->age.load();
-    int num = localBot - oldAge.top;
+    long localBot = this->bottom.load(std::memory_order_relaxed);
+    long localTop = this->top.load(std::memory_order_relaxed);
+    long num = localBot - localTop;
     if (num < 0) {
         num = 0;
     }
-    return num;
+    return (int)num;
 }
 
 } // namespace internal
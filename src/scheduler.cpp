@@ -2,23 +2,34 @@
  * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
  */
 
+#include <fstream>
 #include "scheduler.h"
 
 namespace WSDS {
 
-Scheduler::Scheduler(int nworkers, int workerAlg) {
+Scheduler::Scheduler(int nworkers, int workerAlg, int pinning) {
     this->nworkers = nworkers;
     if (this->nworkers == 0) {
         // match nworkers to available hardware
         this->nworkers = std::thread::hardware_concurrency();
     }
     this->rootTasks = std::vector<Task*>();
+    this->pendingRoots = 0;
     this->workerAlg = workerAlg;
+    this->pinning = pinning;
 
     // only needed for ROUND_ROBIN alg
     this->roundRobinIndex = 0;
 
-    this->distribution = std::uniform_int_distribution<>(0, nworkers-1);
+    // only needed for WORK_STEALING alg
+    this->ninjected = 0;
+
+    // idle workers park until there is work for them
+    this->nsleepers = 0;
+    this->wakeIndex = 0;
+
+    // nothing counted yet
+    this->statsBaseline = {};
 
     // create all workers
     this->create_workers();
@@ -31,6 +42,11 @@ Scheduler::~Scheduler() {
     // stop all workers
     this->stop_workers();
 
+#ifdef WSDS_TRACE
+    // workers are stopped, so their traces can be safely read
+    this->write_trace();
+#endif
+
     // delete objects
     for (int i = 0; i < this->nworkers; i++) {
         delete this->workers[i].thr;
@@ -44,6 +60,18 @@ void Scheduler::spawn(Task* rootTask) {
     // add task to collection of root tasks
     this->rootTasks.push_back(rootTask);
 
+    // count the root task as pending, must happen before it can finish
+    std::unique_lock<std::mutex> lock(this->rootsMutex);
+    this->pendingRoots++;
+    lock.unlock();
+
+    // with work stealing only the owner may push to a deque, so let the
+    // first idle worker pick the root task up
+    if (this->workerAlg == WORK_STEALING) {
+        this->inject_task(rootTask);
+        return;
+    }
+
     // chose a worker, and add root task to ready deque of chosen worker
     internal::Worker* worker = this->next_worker();
     worker->add_ready_task(rootTask, true, false); // forceSelf = true
@@ -53,26 +81,28 @@ void Scheduler::spawn(Task* rootTask) {
 // root tasks to finish
 void Scheduler::wait(void) {
     // wait for computation of all root tasks to complete
-    int ntasks = this->rootTasks.size();
-    for (int i = 0; i < ntasks; i++) {
-
-        // aquire lock on finishedMutex of task
-        std::unique_lock<std::mutex> lock(this->rootTasks[i]->finishedMutex);
-
-        // use CV to wait until task is finished
-        while (!this->rootTasks[i]->is_finished()) {
-            // 1 second timeout just in case something has gone wrong
-            this->rootTasks[i]->finishedCV.wait_for(lock, std::chrono::seconds(1));
-        }
-
-        // release lock
-        lock.unlock();
+    std::unique_lock<std::mutex> lock(this->rootsMutex);
+    while (this->pendingRoots > 0) {
+        this->rootsCV.wait(lock);
     }
+    lock.unlock();
 
     // computation of tasks have been completed and acknowledged, clear out pool
     this->rootTasks.clear();
 }
 
+// called by a worker once it has finished a root task
+void Scheduler::finish_root_task() {
+    // notify while holding the lock, so a woken wait() can not return and
+    // let the scheduler be deleted before the notify is done
+    std::unique_lock<std::mutex> lock(this->rootsMutex);
+    this->pendingRoots--;
+    if (this->pendingRoots == 0) {
+        this->rootsCV.notify_all();
+    }
+    lock.unlock();
+}
+
 // choose the next worker to get a task based on worker algorithm,
 // not needed when using work stealing
 internal::Worker* Scheduler::next_worker(bool forceRandom) {
@@ -86,16 +116,9 @@ internal::Worker* Scheduler::next_worker(bool forceRandom) {
     switch(alg) {
         case ROUND_ROBIN:
             {
-                std::unique_lock<std::mutex> lock(this->roundRobinMutex);
-                worker = this->workers[this->roundRobinIndex].worker;
-
-                // increment round robin index
-                this->roundRobinIndex++;
-                if (this->roundRobinIndex >= this->nworkers) {
-                    this->roundRobinIndex = 0;
-                }
-
-                lock.unlock();
+                // unsigned, so the index wraps around cleanly on overflow
+                unsigned int index = this->roundRobinIndex.fetch_add(1, std::memory_order_relaxed);
+                worker = this->workers[index % this->nworkers].worker;
             }
             break;
 
@@ -108,7 +131,8 @@ internal::Worker* Scheduler::next_worker(bool forceRandom) {
         default:
         case RANDOM:
             {
-                int index = this->distribution(this->generator);
+                // each thread draws from its own generator, no sharing
+                int index = internal::XorShift::local().next_int(this->nworkers);
                 worker = this->workers[index].worker;
             }
             break;
@@ -117,6 +141,97 @@ internal::Worker* Scheduler::next_worker(bool forceRandom) {
     return worker;
 }
 
+// hand a task to whichever worker next runs out of local work, used
+// with work stealing where only a deque's owner may push to it
+void Scheduler::inject_task(Task* task) {
+    std::unique_lock<std::mutex> lock(this->injectedMutex);
+    this->injectedTasks.push_back(task);
+    this->ninjected++;
+    lock.unlock();
+
+    this->notify_work();
+}
+
+// called after making new work visible, wakes one parked worker
+// if there are any
+void Scheduler::notify_work() {
+    // pairs with the fence in Worker::park(), either the parking worker
+    // sees the new work, or we see it counted as a sleeper
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (this->nsleepers.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    // rotate the starting point, so the same workers are not always woken
+    int start = this->wakeIndex.fetch_add(1, std::memory_order_relaxed);
+    for (int i = 0; i < this->nworkers; i++) {
+        int index = (start + i) % this->nworkers;
+        if (this->workers[index].worker->wake()) {
+            return;
+        }
+    }
+}
+
+// snapshot of what all workers have done since they were created or
+// the stats were last reset, summed up over the workers
+Stats Scheduler::stats() {
+    Stats stats = {};
+    for (int i = 0; i < this->nworkers; i++) {
+        this->workers[i].worker->add_stats(stats);
+    }
+    stats.subtract(this->statsBaseline);
+    return stats;
+}
+
+// zero the stats of all workers, by remembering the current snapshot
+// and subtracting it from later ones
+void Scheduler::reset_stats() {
+    // the workers' counters only ever grow, zeroing them from here could
+    // be undone by an increment of a busy worker
+    Stats stats = {};
+    for (int i = 0; i < this->nworkers; i++) {
+        this->workers[i].worker->add_stats(stats);
+    }
+    this->statsBaseline = stats;
+}
+
+// take the oldest injected task, or nullptr if there is none
+Task* Scheduler::take_injected_task() {
+    // avoid the lock entirely in the common case of nothing injected
+    if (this->ninjected.load() == 0) {
+        return nullptr;
+    }
+
+    Task* task = nullptr;
+    std::unique_lock<std::mutex> lock(this->injectedMutex);
+    if (!this->injectedTasks.empty()) {
+        task = this->injectedTasks.front();
+        this->injectedTasks.pop_front();
+        this->ninjected--;
+    }
+    lock.unlock();
+
+    return task;
+}
+
+#ifdef WSDS_TRACE
+// write the traces of all workers to the trace file
+void Scheduler::write_trace() {
+    const char* path = getenv("WSDS_TRACE_FILE");
+    if (path == nullptr) {
+        path = "wsds-trace.json";
+    }
+
+    std::vector<internal::Tracer*> tracers;
+    for (int i = 0; i < this->nworkers; i++) {
+        tracers.push_back(this->workers[i].worker->get_tracer());
+    }
+
+    std::ofstream out(path);
+    internal::Tracer::write_json(out, tracers);
+}
+#endif
+
 // create and start all worker threads if not already started
 void Scheduler::start_workers() {
     // start non-master work loops first
@@ -139,6 +254,15 @@ void Scheduler::start_worker(int id) {
     if (!this->workers[id].started) {
         this->workers[id].started = true;
         this->workers[id].thr = new std::thread([=] {
+            // pin before the worker touches any memory of its own, so its
+            // arena ends up on its NUMA node
+            if (this->workers[id].cpu >= 0 && !internal::Topology::pin_current_thread(this->workers[id].cpu)) {
+                // left floating, so neither its CPU nor its node are known,
+                // and none of its victims are any closer than the others
+                this->workers[id].cpu = -1;
+                this->workers[id].node = -1;
+                this->workers[id].worker->clear_local_victims();
+            }
             this->workers[id].worker->work_loop();
         });
     }
@@ -176,6 +300,18 @@ void Scheduler::create_workers() {
     workers = new internal::WorkerData[this->nworkers];
     for (int i = 0; i < this->nworkers; i++) {
         this->workers[i].ready = false;
+        this->workers[i].cpu = -1;
+        this->workers[i].node = 0;
+    }
+
+    // choose a CPU for each worker if pinning
+    if (this->pinning != NO_PINNING) {
+        internal::Topology topology;
+        std::vector<internal::CpuInfo> placement = topology.placement(this->nworkers, this->pinning);
+        for (int i = 0; i < this->nworkers; i++) {
+            this->workers[i].cpu = placement[i].cpu;
+            this->workers[i].node = placement[i].node;
+        }
     }
 
     // prepare worker 0 (the master worker)
@@ -194,11 +330,13 @@ void Scheduler::create_workers() {
     }
 
     // create a cache of victim references within each worker
-    // all other workers are potential victims
+    // all other workers are potential victims, those on the same NUMA
+    // node are only known when pinning
     for (int i = 0; i < this->nworkers; i++) {
         for (int k = 0; k < this->nworkers; k++) {
             if (i != k) {
-                this->workers[i].worker->add_victim(this->workers[k].worker);
+                bool local = this->pinning != NO_PINNING && this->workers[i].node == this->workers[k].node;
+                this->workers[i].worker->add_victim(this->workers[k].worker, local);
             }
         }
     }
@@ -212,26 +350,20 @@ void Scheduler::create_worker(int id, int nvictims) {
 	this->workers[id].ready = true;
 }
 
-// determine worker with smallest number of waiting ready tasks
+// determine a worker with few waiting ready tasks, the less loaded of
+// two sampled at random
 internal::Worker* Scheduler::worker_with_smallest_deque() {
-    int workerIndex = 0;
-    int smallestSize = INT_MAX;
-
-    for (int i = 0; i < this->nworkers; i++) {
-        internal::Worker* worker = this->workers[i].worker;
-        int dequeSize = worker->get_ready_deque_size();
-        if (dequeSize < smallestSize) {
-            smallestSize = dequeSize;
-            workerIndex = i;
-
-            // cannot get smaller than an empty deque
-            if (dequeSize == 0) {
-                break;
-            }
-        }
+    // power of two choices, nearly as balanced as scanning every worker
+    // while costing two unlocked reads of deque sizes, however many
+    // workers there are
+    internal::XorShift& rng = internal::XorShift::local();
+    internal::Worker* first = this->workers[rng.next_int(this->nworkers)].worker;
+    internal::Worker* second = this->workers[rng.next_int(this->nworkers)].worker;
+
+    if (second->get_ready_deque_size() < first->get_ready_deque_size()) {
+        return second;
     }
-
-    return this->workers[workerIndex].worker;
+    return first;
 }
 
 } // namespace WSDS
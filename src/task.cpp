@@ -3,6 +3,7 @@
  */
 
 #include "task.h"
+#include "scheduler.h"
 
 namespace WSDS {
 
@@ -11,24 +12,42 @@ std::atomic<int> next_task_id{0}; // used to id tasks for debugging
 Task::Task() {
     this->worker = nullptr;
     this->parent = nullptr;
-    this->children = std::vector<Task*>();
-    this->finished = false;
+    this->state.store(0, std::memory_order_relaxed);
     this->id = next_task_id++;
 }
 
 Task::~Task() {}
 
+// destroy a task made by create() and return its memory for reuse
+void Task::recycle(Task* task) {
+    if (task == nullptr) {
+        return;
+    }
+
+    task->~Task();
+    internal::TaskArena::release(task);
+}
+
 // function worker will call this in order to process the task
 void Task::process(internal::Worker* worker) {
     this->worker = worker;
 
     // only process if not already finished
     if (!this->is_finished()) {
+        // nothing may touch the task once it finished, so check up front
+        bool recycle = this->state.load(std::memory_order_relaxed) & RECYCLE;
+
         // execute task computation
+        WSDS_TRACE_TASK_BEGIN(worker, this->id);
         this->execute();
+        WSDS_TRACE_TASK_END(worker, this->id);
 
         // task computation done, finish the task
         this->finish_task();
+
+        if (recycle) {
+            Task::recycle(this);
+        }
     }
 }
 
@@ -37,10 +56,11 @@ void Task::spawn(Task* task) {
     // mark self as parent of child task
     task->parent = this;
 
-    // add child task to list of children
-    this->children.push_back(task);
+    // count the child as pending, must happen before it can finish
+    this->state.fetch_add(1, std::memory_order_relaxed);
 
     // add child task to a worker's ready deque
+    this->worker->count_spawn();
     this->worker->add_ready_task(task);
 }
 
@@ -51,42 +71,41 @@ void Task::spawn(Task* task) {
 void Task::wait(void) {
     // check if ready, if not start a wait_loop
     if (!this->is_ready()) {
-        this->worker->wait_loop();
+        this->worker->wait_loop(this);
     }
-
-    // computation of children tasks have been completed and acknowledged
-    this->children.clear();
 }
 
 // is the task in a ready state for processing?
 bool Task::is_ready(void) {
-    // ready if and only if all children tasks are finished
-    int nchildren = this->children.size();
-    for (int i = 0; i < nchildren; i++) {
-        if (!this->children[i]->is_finished()) {
-            return false;
-        }
-    }
-    return true;
+    // ready if and only if all children tasks are finished, acquire pairs
+    // with the release in the children's finish_task() so their results
+    // are visible
+    return (this->state.load(std::memory_order_acquire) & PENDING_MASK) == 0;
 }
 
 // is the task computation finished?
 bool Task::is_finished() {
-    return this->finished;
+    return (this->state.load(std::memory_order_acquire) & FINISHED) != 0;
 }
 
 // indicate task computation is finished
 void Task::finish_task() {
-    // aquire lock on finishedMutex of task
-    std::unique_lock<std::mutex> lock(this->finishedMutex);
+    // whoever is waiting on this task may delete it as soon as it learns
+    // the task finished, so collect everything needed beforehand
+    Task* parent = this->parent;
+    Scheduler* scheduler = this->worker->get_scheduler();
 
-    this->finished = true;
+    this->state.fetch_or(FINISHED, std::memory_order_release);
 
-    // release lock
-    lock.unlock();
-
-    // notify any waiting tasks
-    this->finishedCV.notify_all();
+    if (parent != nullptr) {
+        // let the parent know one less child is pending, release pairs with
+        // the acquire in the parent's is_ready() so results are visible
+        parent->state.fetch_sub(1, std::memory_order_release);
+    }
+    else {
+        // root tasks are waited on through the scheduler
+        scheduler->finish_root_task();
+    }
 }
 
 // get the parent of the current task
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <tuple>
+#include <ctype.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include "topology.h"
+
+namespace WSDS {
+
+/*
+ * Internal data structures and functions not expected to be used
+ * by user applications utilizing the WSDS user-level scheduler.
+ */
+namespace internal {
+
+static const std::string SYSFS_CPU = "/sys/devices/system/cpu";
+
+Topology::Topology() {
+    this->read_sysfs();
+
+    if (this->cpus.empty()) {
+        // no sysfs, fall back to a flat layout
+        int ncpus = std::thread::hardware_concurrency();
+        for (int i = 0; i < std::max(ncpus, 1); i++) {
+            this->cpus.push_back({i, 0, 0, i});
+        }
+    }
+
+    this->restrict_to_affinity();
+}
+
+Topology::Topology(std::vector<CpuInfo> cpus) {
+    this->cpus = cpus;
+}
+
+// choose a CPU for each of nworkers workers following the given
+// pinning policy, wrapping around if there are more workers than CPUs
+std::vector<CpuInfo> Topology::placement(int nworkers, int pinning) {
+    std::vector<CpuInfo> order = this->cpus;
+
+    if (pinning == PIN_SCATTER) {
+        // rank each CPU among the SMT threads of its core, and each core
+        // among the cores of its node
+        std::map<std::pair<int, int>, int> smtCount;
+        std::map<std::pair<int, int>, int> coreRank;
+        std::map<int, int> coreCount;
+        std::map<int, std::tuple<int, int, int>> keys;
+
+        std::sort(order.begin(), order.end(), [](const CpuInfo& a, const CpuInfo& b) {
+            return std::tie(a.node, a.package, a.core, a.cpu) < std::tie(b.node, b.package, b.core, b.cpu);
+        });
+        for (CpuInfo& info : order) {
+            std::pair<int, int> core(info.package, info.core);
+            int smt = smtCount[core]++;
+            if (smt == 0) {
+                coreRank[core] = coreCount[info.node]++;
+            }
+            keys[info.cpu] = std::make_tuple(smt, coreRank[core], info.node);
+        }
+
+        // first SMT thread of the first core of every node, then of the
+        // second core, ..., and only then the second SMT threads
+        std::stable_sort(order.begin(), order.end(), [&](const CpuInfo& a, const CpuInfo& b) {
+            return keys[a.cpu] < keys[b.cpu];
+        });
+    }
+    else {
+        // all SMT threads of a core, then all cores of a node, then the
+        // next node
+        std::sort(order.begin(), order.end(), [](const CpuInfo& a, const CpuInfo& b) {
+            return std::tie(a.node, a.package, a.core, a.cpu) < std::tie(b.node, b.package, b.core, b.cpu);
+        });
+    }
+
+    std::vector<CpuInfo> placed;
+    for (int i = 0; i < nworkers; i++) {
+        placed.push_back(order[i % order.size()]);
+    }
+    return placed;
+}
+
+// pin the calling thread to the given CPU, returns false on failure
+bool Topology::pin_current_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// read the layout of all online CPUs
+void Topology::read_sysfs() {
+    std::ifstream online(SYSFS_CPU + "/online");
+    std::string ranges;
+    if (!(online >> ranges)) {
+        return;
+    }
+
+    // list of ranges, e.g. "0-3,8-11"
+    size_t pos = 0;
+    while (pos < ranges.size()) {
+        size_t end = ranges.find(',', pos);
+        if (end == std::string::npos) {
+            end = ranges.size();
+        }
+        std::string range = ranges.substr(pos, end - pos);
+        pos = end + 1;
+
+        size_t dash = range.find('-');
+        int first = atoi(range.c_str());
+        int last = (dash == std::string::npos) ? first : atoi(range.c_str() + dash + 1);
+
+        for (int cpu = first; cpu <= last; cpu++) {
+            std::string topology = SYSFS_CPU + "/cpu" + std::to_string(cpu) + "/topology";
+            CpuInfo info;
+            info.cpu = cpu;
+            info.node = read_node(cpu);
+            info.package = read_int(topology + "/physical_package_id", 0);
+            info.core = read_int(topology + "/core_id", cpu);
+            this->cpus.push_back(info);
+        }
+    }
+}
+
+// drop the CPUs the calling process may not run on
+void Topology::restrict_to_affinity() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return;
+    }
+
+    std::vector<CpuInfo> allowed;
+    for (CpuInfo& info : this->cpus) {
+        if (info.cpu < CPU_SETSIZE && CPU_ISSET(info.cpu, &set)) {
+            allowed.push_back(info);
+        }
+    }
+
+    // an empty intersection means the layout is off, keep it rather than
+    // have nowhere to place workers, pinning will then fail and say so
+    if (!allowed.empty()) {
+        this->cpus = allowed;
+    }
+}
+
+// read the NUMA node of the given CPU
+int Topology::read_node(int cpu) {
+    // the CPU's directory links to its node as "node<N>"
+    DIR* dir = opendir((SYSFS_CPU + "/cpu" + std::to_string(cpu)).c_str());
+    if (dir == nullptr) {
+        return 0;
+    }
+
+    int node = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (!strncmp(entry->d_name, "node", 4) && isdigit(entry->d_name[4])) {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+
+    return node;
+}
+
+// read a single integer from a sysfs file, or fallback if unreadable
+int Topology::read_int(std::string path, int fallback) {
+    std::ifstream file(path);
+    int value;
+    if (!(file >> value)) {
+        return fallback;
+    }
+    return value;
+}
+
+} // namespace internal
+
+} // namespace WSDS
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#include "trace.h"
+
+namespace WSDS {
+
+/*
+ * Internal data structures and functions not expected to be used
+ * by user applications utilizing the WSDS user-level scheduler.
+ */
+namespace internal {
+
+Tracer::Tracer(int workerId, size_t capacity) {
+    this->workerId = workerId;
+    this->events = std::vector<TraceEvent>(capacity);
+    this->next = 0;
+    this->wrapped = false;
+}
+
+// write the events of all tracers as a Chrome trace JSON document
+void Tracer::write_json(std::ostream& out, std::vector<Tracer*>& tracers) {
+    // timestamps are relative to the earliest event of any worker
+    uint64_t epoch = UINT64_MAX;
+    for (Tracer* tracer : tracers) {
+        if (tracer->get_nevents() > 0 && tracer->get_event(0).time < epoch) {
+            epoch = tracer->get_event(0).time;
+        }
+    }
+
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (Tracer* tracer : tracers) {
+        // name each worker's row in the viewer
+        out << (first ? "" : ",") << std::endl;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << tracer->workerId
+            << ",\"args\":{\"name\":\"worker " << tracer->workerId << "\"}}";
+        first = false;
+
+        for (size_t i = 0; i < tracer->get_nevents(); i++) {
+            TraceEvent& event = tracer->get_event(i);
+            double ts = (event.time - epoch) / 1000.0; // in us
+
+            out << "," << std::endl;
+            switch (event.type) {
+                case TASK_BEGIN:
+                case TASK_END:
+                    out << "{\"name\":\"task " << event.id << "\",\"cat\":\"task\",\"ph\":\""
+                        << (event.type == TASK_BEGIN ? "B" : "E") << "\",\"ts\":" << ts;
+                    break;
+
+                default:
+                case STEAL:
+                    out << "{\"name\":\"steal from " << event.id << "\",\"cat\":\"steal\",\"ph\":\"X\",\"ts\":"
+                        << ts << ",\"dur\":" << event.duration / 1000.0;
+                    break;
+            }
+            out << ",\"pid\":0,\"tid\":" << tracer->workerId << "}";
+        }
+    }
+    out << std::endl << "]}" << std::endl;
+}
+
+} // namespace internal
+
+} // namespace WSDS
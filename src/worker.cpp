@@ -18,142 +18,370 @@ Worker::Worker(int id, int nvictims, Scheduler* scheduler, int workerAlg) {
     this->stopped = false;
     this->workerAlg = workerAlg;
     this->assignedTask = nullptr;
+    this->assignedBase = 0;
+    this->waitDepth = 0;
     this->nvictims = 0;
+    this->nlocalVictims = 0;
+    this->localMisses = 0;
+    this->lastVictim = -1;
+    this->stealBackoff = 1;
+    this->counters.reset();
+#ifdef WSDS_TRACE
+    this->tracer = new Tracer(id);
+#endif
     this->victimDeqs = new Deque*[nvictims];
-    this->readyDeq = new Deque(id, 100000); // TODO - size needs to be dynamic
+    this->readyDeq = new Deque(id); // grows on demand
+    this->arena = new TaskArena();
     this->scheduler = scheduler;
-    this->distribution = std::uniform_int_distribution<>(0, nvictims-1);
+    this->idleSpins = MIN_IDLE_SPINS;
+    this->sleeping = false;
+    this->wakeSignal = false;
 }
 
 Worker::~Worker() {
     delete[] this->victimDeqs;
     delete this->readyDeq;
+    delete this->arena;
+#ifdef WSDS_TRACE
+    delete this->tracer;
+#endif
 }
 
-// add a "victim" worker to cache of potential victims
-void Worker::add_victim(Worker* victim) {
+// add a "victim" worker to cache of potential victims, local
+// victims share this worker's NUMA node
+void Worker::add_victim(Worker* victim, bool local) {
     this->victimDeqs[this->nvictims] = victim->readyDeq;
+
+    if (local) {
+        // keep local victims in front of the remote ones
+        std::swap(this->victimDeqs[this->nvictims], this->victimDeqs[this->nlocalVictims]);
+        this->nlocalVictims++;
+    }
+
     this->nvictims++;
 }
 
+// treat all victims as remote, for a worker that is not on the NUMA
+// node its local victims were chosen for
+void Worker::clear_local_victims() {
+    this->nlocalVictims = 0;
+    this->localMisses = 0;
+}
+
 // add a task to a worker's ready pool
 void Worker::add_ready_task(Task* task, bool forceSelf, bool forceNotSelf) {
+    if (this->workerAlg == WORK_STEALING) {
+        if (forceNotSelf) {
+            // only the owner may push to a deque, so let some other
+            // worker pick the task up once it runs out of local work
+            this->scheduler->inject_task(task);
+        }
+        else {
+            // lock-free owner path, relies only on the deque's atomics
+            this->readyDeq->push_bottom(task);
+        }
+
+        // new work to steal, wake a parked worker if there is one
+        this->scheduler->notify_work();
+        return;
+    }
+
     Worker* worker = this;
 
     if (!forceSelf) {
-        if (this->workerAlg != WORK_STEALING || forceNotSelf) {
-            // determine worker based on worker algorithm via Scheduler
-            worker = this->scheduler->next_worker();
+        // determine worker based on worker algorithm via Scheduler
+        worker = this->scheduler->next_worker();
 
-            while (forceNotSelf && worker == this) {
-                // force a random worker, need for this should be rare
-                worker = this->scheduler->next_worker(true);
-            }
+        while (forceNotSelf && worker == this) {
+            // force a random worker, need for this should be rare
+            worker = this->scheduler->next_worker(true);
         }
     }
 
+    // pushing to another worker's deque, so owners must also lock
     std::unique_lock<std::mutex> lock(worker->dequeMutex);
     worker->readyDeq->push_bottom(task);
     lock.unlock();
+
+    // only the chosen worker can run the task, make sure it is awake
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    worker->wake();
 }
 
 // indicate this worker should be stopped
 void Worker::stop() {
     this->stopped = true;
+
+    // a parked worker checks stopped under the lock before sleeping
+    std::unique_lock<std::mutex> lock(this->sleepMutex);
+    this->sleepCV.notify_all();
+    lock.unlock();
+}
+
+// wake the worker if it is parked, returns false if it was not
+bool Worker::wake() {
+    // only one waker may claim a parked worker
+    if (!this->sleeping.load(std::memory_order_relaxed) || !this->sleeping.exchange(false)) {
+        return false;
+    }
+    this->scheduler->remove_sleeper();
+
+    std::unique_lock<std::mutex> lock(this->sleepMutex);
+    this->wakeSignal = true;
+    this->sleepCV.notify_one();
+    lock.unlock();
+
+    return true;
+}
+
+// park the worker until woken, unless work turns up meanwhile
+void Worker::park() {
+    // announce we are about to sleep before the final check for work,
+    // pairs with the fence in Scheduler::notify_work() so that either we
+    // see the new work, or the notifier sees us sleeping
+    this->sleeping.store(true);
+    this->scheduler->add_sleeper();
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (this->has_visible_work() || this->stopped.load()) {
+        // cancel, unless a waker already claimed us, in which case its
+        // wake signal just makes the next park return right away
+        if (this->sleeping.exchange(false)) {
+            this->scheduler->remove_sleeper();
+        }
+        return;
+    }
+
+    // going to sleep, so hand batched frees back to their owners
+    TaskArena::flush_pending();
+
+    std::unique_lock<std::mutex> lock(this->sleepMutex);
+    while (!this->wakeSignal && !this->stopped.load()) {
+        this->sleepCV.wait(lock);
+    }
+    this->wakeSignal = false;
+    lock.unlock();
+
+    // a stale wake signal, left by a waker that claimed us while we were
+    // cancelling an earlier park, or a stop, ends the wait without anyone
+    // claiming us, so stop counting as a sleeper ourselves
+    if (this->sleeping.exchange(false)) {
+        this->scheduler->remove_sleeper();
+    }
+}
+
+// is there any work this worker could pick up?
+bool Worker::has_visible_work() {
+    if (this->readyDeq->get_num_tasks() > 0) {
+        return true;
+    }
+
+    if (this->workerAlg != WORK_STEALING) {
+        // only ever handed work through our own deque
+        return false;
+    }
+
+    if (this->scheduler->has_injected_tasks()) {
+        return true;
+    }
+    for (int i = 0; i < this->nvictims; i++) {
+        if (this->victimDeqs[i]->get_num_tasks() > 0) {
+            return true;
+        }
+    }
+    return false;
 }
 
 // the main work loop of the worker
 void Worker::work_loop() {
+    // tasks created on this thread come from this worker's arena
+    TaskArena::set_current(this->arena);
+    current = this;
+
+    // rounds spent looking for work since last finding some
+    int spins = 0;
+
+    // has the worker run out of work?
+    bool idle = false;
+
     // continue in work loop until a stop is indicated
     while(!this->stopped.load()) {
 
         // attempt to collect next ready task
-        std::unique_lock<std::mutex> lock(this->dequeMutex);
-        this->assignedTask = this->readyDeq->pop_bottom();
-        lock.unlock();
+        Task* task = this->pop_ready_task();
 
-        // if no task, attempt to steal one if using stealing
-        if (this->assignedTask == nullptr && this->workerAlg == WORK_STEALING) {
-            // no local ready task, attempt to steal one after yielding
-            std::this_thread::yield();
-            this->assignedTask = steal_task();
+        // if no task, attempt to pick up an injected one or steal one
+        // if using stealing
+        if (task == nullptr && this->workerAlg == WORK_STEALING) {
+            task = this->scheduler->take_injected_task();
+
+            if (task == nullptr) {
+                // no local ready task, attempt to steal one, steal_task()
+                // backs off by itself when there is nothing to steal
+                task = steal_task();
+            }
+        }
+
+        if (task != nullptr) {
+            // spinning paid off, allow spinning longer next time
+            if (spins > 0 && this->idleSpins < MAX_IDLE_SPINS) {
+                this->idleSpins *= 2;
+            }
+            spins = 0;
+
+            if (idle) {
+                // the idle stretch ends, see WorkerCounters
+                WorkerCounters::add(this->counters.idleNanos, WorkerCounters::now_nanos());
+                idle = false;
+            }
+
+            this->run_task(task);
+            continue;
+        }
+
+        if (!idle) {
+            // an idle stretch starts, snapshots count it from here on
+            WorkerCounters::add(this->counters.idleNanos, -WorkerCounters::now_nanos());
+            idle = true;
         }
 
-        // if we have an assigned task, process it
-        if (this->assignedTask != nullptr) {
-            // only if not already finished
-            if (!this->assignedTask->is_finished()) {
-                this->assignedTask->process(this);
+        if (++spins >= this->idleSpins) {
+            // spun without finding work, park until some shows up and
+            // spin for less time next time
+            if (this->idleSpins > MIN_IDLE_SPINS) {
+                this->idleSpins /= 2;
             }
-            this->assignedTask = nullptr;
+            spins = 0;
+
+            this->park();
         }
+        else if (this->workerAlg != WORK_STEALING) {
+            // nothing to steal, so just give up the core between checks
+            std::this_thread::yield();
+        }
+
+    }
 
+    // end the last idle stretch, so it stops growing in snapshots
+    if (idle) {
+        WorkerCounters::add(this->counters.idleNanos, WorkerCounters::now_nanos());
     }
+
+    // return any batched frees before the thread exits
+    TaskArena::set_current(nullptr);
+    current = nullptr;
 }
 
 // secondary work loop for when the task being processed calls a wait()
 // and can not proceed until all its children tasks have finished
-void Worker::wait_loop() {
+void Worker::wait_loop(Task* waitingTask) {
 
-    // move current assigned task to a waiting state
-    Task* waitingTask = this->assignedTask;
-    bool waitingTaskReady = false;
-    this->assignedTask = nullptr;
+    // ready tasks above this deque index were pushed while processing the
+    // waiting task, so they all originate from it, or were stolen in a
+    // batch by this wait loop and may run here just as well
+    long base = this->assignedBase;
+    this->waitDepth++;
 
     // continue in wait loop until a stop is indicated,
     // or the waitingTask has become ready
-    while (!this->stopped.load() && !waitingTaskReady) {
+    while (!this->stopped.load() && !waitingTask->is_ready()) {
+        WorkerCounters::add(this->counters.waitIterations);
 
-        // attempt to collect next ready task
-        std::unique_lock<std::mutex> lock(this->dequeMutex);
-        this->assignedTask = this->readyDeq->pop_bottom();
-        lock.unlock();
+        Task* task = nullptr;
 
-        if (this->assignedTask == nullptr) {
-            // ready deq empty, attempt to steal a task if using stealing
-            if (this->workerAlg == WORK_STEALING) {
-                std::this_thread::yield();
-                this->assignedTask = steal_task();
+        if (this->workerAlg == WORK_STEALING) {
+            // prefer our own children, popped without any locking
+            if (this->readyDeq->get_bottom_index() > base) {
+                task = this->readyDeq->pop_bottom();
             }
-        }
 
-        // if we have an assigned task, check if workable and process it
-        if (this->assignedTask != nullptr) {
-            if (!this->assignedTask->is_finished()) {
+            // no children left here, they are running on the workers that
+            // stole them, so help out by running some other task on top of
+            // the waiting one, as long as the stack is not too deep
+            if (task == nullptr && this->waitDepth <= MAX_WAIT_DEPTH) {
+                task = this->scheduler->take_injected_task();
 
-                // IMPORTANT NOTE!
-                // In order to process the task here, it must originate from the
-                // waiting task (be a child, grandchild, great-grandchild, ...),
-                // otherwise a hang is possible where no worker can makes progress.
-
-                // trace parents of chosen task looking for the waiting task
-                Task* parent = this->assignedTask->get_parent();
-                while (parent != nullptr && parent != waitingTask) {
-                    parent = parent->get_parent();
+                if (task == nullptr) {
+                    task = steal_task();
                 }
+            }
+            else if (task == nullptr) {
+                // too deep to help out, so only our children can finish the
+                // waiting task, give their workers the core meanwhile
+                this->back_off();
+            }
+        }
+        else {
+            // other workers push to our deque, so any task may turn up
+            task = this->pop_ready_task();
 
-                if (parent == waitingTask) {
-                    // originated from waiting task, process it to make progress
-                    this->assignedTask->process(this);
-                }
-                else {
-                    // did not originate from waiting task and is not workable,
-                    // add the task to the ready deque of some other worker
-                    Task* tmpTask = this->assignedTask;
-                    this->add_ready_task(tmpTask, false, true); // forceNotSelf = true
-                }
+            if (task == nullptr) {
+                // children run elsewhere, give their workers the core meanwhile
+                std::this_thread::yield();
+            }
+            else if (this->waitDepth > MAX_WAIT_DEPTH && !this->originates_from(task, waitingTask)) {
+                // once the stack is too deep, only tasks originating from the
+                // waiting task may run on top of it, hand others to another worker
+                this->add_ready_task(task, false, true); // forceNotSelf = true
+                WorkerCounters::add(this->counters.foreignRepushes);
+                task = nullptr;
             }
-            this->assignedTask = nullptr;
         }
 
-        // check if waiting task has become available
-        if (waitingTask->is_ready()) {
-            waitingTaskReady = true;
+        // IMPORTANT NOTE!
+        // Running a task on top of the waiting task can not hang, since a
+        // task only ever waits on tasks that started after it did: its
+        // children, and whatever runs on top of it in its own wait_loop.
+        if (task != nullptr) {
+            this->run_task(task);
         }
     }
 
-    // return to execution of the now ready waiting task
-    this->assignedTask = waitingTask;
+    this->waitDepth--;
+}
+
+// process a task, keeping track of where its frame starts in the deque
+void Worker::run_task(Task* task) {
+    // only if not already finished
+    if (task->is_finished()) {
+        return;
+    }
+
+    WorkerCounters::add(this->counters.tasksExecuted);
+
+    Task* prevTask = this->assignedTask;
+    long prevBase = this->assignedBase;
+
+    this->assignedTask = task;
+    this->assignedBase = this->readyDeq->get_bottom_index();
+    task->process(this);
+
+    this->assignedTask = prevTask;
+    this->assignedBase = prevBase;
+}
+
+// does task originate from ancestor (child, grandchild, ...)?
+bool Worker::originates_from(Task* task, Task* ancestor) {
+    Task* parent = task->get_parent();
+    while (parent != nullptr && parent != ancestor) {
+        parent = parent->get_parent();
+    }
+    return parent == ancestor;
+}
+
+// remove and return a task from the bottom of the worker's own ready deque
+Task* Worker::pop_ready_task() {
+    if (this->workerAlg == WORK_STEALING) {
+        // lock-free owner path, relies only on the deque's atomics
+        return this->readyDeq->pop_bottom();
+    }
+
+    // other workers may push to this deque, so the owner must also lock
+    std::unique_lock<std::mutex> lock(this->dequeMutex);
+    Task* task = this->readyDeq->pop_bottom();
+    lock.unlock();
+
+    return task;
 }
 
 // attempt to steal a task from a "victim"
@@ -163,21 +391,106 @@ Task* Worker::steal_task() {
         return nullptr;
     }
 
-    // pick random victim
-    int index = this->distribution(this->generator);
+    WSDS_TRACE_STEAL_START(traceStart);
+
+    // sweep through several victims, starting with the last one that had
+    // work for us, since it likely still has more
+    for (int i = 0; i < STEAL_SWEEP; i++) {
+        int index = (i == 0 && this->lastVictim >= 0) ? this->lastVictim : this->pick_victim();
+
+        Task* task = this->steal_from(index);
+        if (task != nullptr) {
+            // only successful steals are traced, failed ones would quickly
+            // flood the trace of an idle worker
+            WSDS_TRACE_STEAL(this, traceStart, this->victimDeqs[index]->get_id());
+
+            this->lastVictim = index;
+            this->localMisses = 0;
+            this->stealBackoff = 1;
+            return task;
+        }
+
+        if (index == this->lastVictim) {
+            this->lastVictim = -1;
+        }
+        if (index < this->nlocalVictims) {
+            this->localMisses++;
+        }
+    }
+
+    // every victim we tried was empty, back off exponentially before the
+    // next attempt to keep from hammering their deques
+    this->back_off();
+
+    return nullptr;
+}
+
+// yield the core for a while after finding no work, twice as long as
+// the last time, up to MAX_STEAL_BACKOFF yields
+void Worker::back_off() {
+    for (int i = 0; i < this->stealBackoff; i++) {
+        std::this_thread::yield();
+    }
+    if (this->stealBackoff < MAX_STEAL_BACKOFF) {
+        this->stealBackoff *= 2;
+    }
+}
+
+// choose a random victim, preferring the ones on our own NUMA node
+int Worker::pick_victim() {
+    // stay local until local victims have turned out empty a few times
+    if (this->localMisses < this->nlocalVictims * LOCAL_STEAL_ATTEMPTS) {
+        return XorShift::local().next_int(this->nlocalVictims);
+    }
+
+    this->localMisses = 0;
+    return XorShift::local().next_int(this->nvictims);
+}
+
+// attempt to steal a task from the given victim, retrying as long as
+// we only lose races for its tasks
+Task* Worker::steal_from(int index) {
     Deque* victimDeq = this->victimDeqs[index];
 
-    // attempt to steal task from top of victim deque
-    return victimDeq->pop_top();
+    Task* task;
+    bool aborted;
+    do {
+        WorkerCounters::add(this->counters.stealAttempts);
+
+        // attempt to steal task from top of victim deque, taking a whole
+        // batch of them into our own deque if the victim has plenty
+        if (MAX_STEAL_BATCH > 1 && victimDeq->get_num_tasks() >= STEAL_BATCH_THRESHOLD) {
+            task = victimDeq->pop_top_batch(this->readyDeq, MAX_STEAL_BATCH, &aborted);
+        }
+        else {
+            task = victimDeq->pop_top(&aborted);
+        }
+
+        // an ABORT means someone else got the task, but the victim may
+        // well have more, unlike after an EMPTY
+        if (aborted) {
+            WorkerCounters::add(this->counters.abortedSteals);
+        }
+    } while (task == nullptr && aborted);
+
+    if (task == nullptr) {
+        return nullptr;
+    }
+    WorkerCounters::add(this->counters.steals);
+
+    // victim, or we after a batch, still have more, pass the wake up
+    // along to another worker
+    if (victimDeq->get_num_tasks() > 0 || this->readyDeq->get_num_tasks() > 0) {
+        this->scheduler->notify_work();
+    }
+
+    return task;
 }
 
-// get the current size of the ready deque (number of waiting ready tasks)
+// get the current size of the ready deque (number of waiting ready
+// tasks), only approximate while other threads push or pop
 int Worker::get_ready_deque_size() {
-    std::unique_lock<std::mutex> lock(this->dequeMutex);
-    int ntasks = this->readyDeq->get_num_tasks();
-    lock.unlock();
-
-    return ntasks;
+    return this->readyDeq->get_num_tasks();
 }
 
 } // namespace internal
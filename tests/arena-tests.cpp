@@ -0,0 +1,99 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#define _UNIT_TESTING
+
+#include "arena.h"
+#include <set>
+#include <thread>
+#include <vector>
+
+// Google Unit Testing Framework
+#include <gtest/gtest.h>
+
+TEST(TaskArena, heap_fallback_without_arena) {
+    ASSERT_EQ(nullptr, WSDS::internal::TaskArena::get_current());
+
+    void* ptr = WSDS::internal::TaskArena::allocate(48);
+    ASSERT_NE(nullptr, ptr);
+    ASSERT_EQ(0u, (size_t)ptr % WSDS::internal::TaskArena::ALIGNMENT);
+
+    WSDS::internal::TaskArena::release(ptr);
+}
+
+TEST(TaskArena, local_free_is_reused) {
+    WSDS::internal::TaskArena* arena = new WSDS::internal::TaskArena();
+    WSDS::internal::TaskArena::set_current(arena);
+
+    void* ptr1 = WSDS::internal::TaskArena::allocate(48);
+    WSDS::internal::TaskArena::release(ptr1);
+    void* ptr2 = WSDS::internal::TaskArena::allocate(48);
+
+    ASSERT_EQ(ptr1, ptr2);
+    ASSERT_EQ(1u, arena->get_nslabs());
+
+    // a different size class does not reuse the block
+    void* ptr3 = WSDS::internal::TaskArena::allocate(200);
+    ASSERT_NE(ptr2, ptr3);
+
+    WSDS::internal::TaskArena::release(ptr2);
+    WSDS::internal::TaskArena::release(ptr3);
+
+    WSDS::internal::TaskArena::set_current(nullptr);
+    delete arena;
+}
+
+TEST(TaskArena, large_blocks_come_from_heap) {
+    WSDS::internal::TaskArena* arena = new WSDS::internal::TaskArena();
+    WSDS::internal::TaskArena::set_current(arena);
+
+    void* ptr = WSDS::internal::TaskArena::allocate(4096);
+    ASSERT_EQ(0u, arena->get_nslabs());
+    WSDS::internal::TaskArena::release(ptr);
+
+    WSDS::internal::TaskArena::set_current(nullptr);
+    delete arena;
+}
+
+TEST(TaskArena, cross_thread_frees_return_to_owner) {
+    WSDS::internal::TaskArena* owner = new WSDS::internal::TaskArena();
+    WSDS::internal::TaskArena* other = new WSDS::internal::TaskArena();
+    WSDS::internal::TaskArena::set_current(owner);
+
+    int nblocks = 100;
+    std::vector<void*> blocks(nblocks);
+    for (int i = 0; i < nblocks; i++) {
+        blocks[i] = WSDS::internal::TaskArena::allocate(48);
+    }
+    size_t nslabs = owner->get_nslabs();
+
+    // another worker frees every block, batching them up for the owner
+    std::thread thr([&] {
+        WSDS::internal::TaskArena::set_current(other);
+        for (int i = 0; i < nblocks; i++) {
+            WSDS::internal::TaskArena::release(blocks[i]);
+        }
+        ASSERT_GT(other->get_npending(), 0);
+        WSDS::internal::TaskArena::set_current(nullptr);
+        ASSERT_EQ(0, other->get_npending());
+    });
+    thr.join();
+
+    // the owner reuses all of them without carving new blocks
+    std::set<void*> original(blocks.begin(), blocks.end());
+    for (int i = 0; i < nblocks; i++) {
+        void* ptr = WSDS::internal::TaskArena::allocate(48);
+        ASSERT_EQ(1u, original.count(ptr));
+        blocks[i] = ptr;
+    }
+    ASSERT_EQ(nslabs, owner->get_nslabs());
+
+    for (int i = 0; i < nblocks; i++) {
+        WSDS::internal::TaskArena::release(blocks[i]);
+    }
+
+    WSDS::internal::TaskArena::set_current(nullptr);
+    delete other;
+    delete owner;
+}
@@ -6,6 +6,8 @@
 
 #include "deque.h"
 #include "increment-task.h"
+#include <thread>
+#include <vector>
 
 // Google Unit Testing Framework
 #include <gtest/gtest.h>
@@ -17,10 +19,9 @@ TEST(Deque, creating_and_deleting) {
 
     ASSERT_EQ(id, deque->get_id());
     ASSERT_EQ(size, deque->get_size());
-    ASSERT_NE(nullptr, deque->get_collection());
     ASSERT_EQ(0, deque->get_bottom());
-    ASSERT_EQ(0, deque->get_tag());
     ASSERT_EQ(0, deque->get_top());
+    ASSERT_EQ(0, deque->get_nretired());
 
     delete deque;
 }
@@ -36,9 +37,7 @@ TEST(Deque, single_push) {
 
     deque->push_bottom(task);
 
-    WSDS::Task** collection = deque->get_collection();
-    ASSERT_NE(nullptr, collection);
-    ASSERT_EQ(task, collection[0]);
+    ASSERT_EQ(task, deque->get_slot(0));
     ASSERT_EQ(1, deque->get_bottom());
     ASSERT_EQ(0, deque->get_top());
 
@@ -62,8 +61,10 @@ TEST(Deque, single_push_and_pop) {
     WSDS::Task* task_returned = deque->pop_bottom();
 
     ASSERT_EQ(task, task_returned);
-    ASSERT_EQ(0, deque->get_bottom());
-    ASSERT_EQ(0, deque->get_top());
+    // indices are never reset, popping the last task claims it from the top
+    ASSERT_EQ(1, deque->get_bottom());
+    ASSERT_EQ(1, deque->get_top());
+    ASSERT_EQ(0, deque->get_num_tasks());
 
     delete task;
     delete deque;
@@ -97,8 +98,10 @@ TEST(Deque, two_pushes_and_two_pops) {
     WSDS::Task* task1_returned = deque->pop_bottom();
 
     ASSERT_EQ(task1, task1_returned);
-    ASSERT_EQ(0, deque->get_bottom());
-    ASSERT_EQ(0, deque->get_top());
+    // indices are never reset, popping the last task claims it from the top
+    ASSERT_EQ(1, deque->get_bottom());
+    ASSERT_EQ(1, deque->get_top());
+    ASSERT_EQ(0, deque->get_num_tasks());
 
     delete task1;
     delete task2;
@@ -145,3 +148,276 @@ TEST(Deque, empty_deque_top_and_bottom_pops) {
 
     delete deque;
 }
+
+TEST(Deque, growth_preserves_lifo_order) {
+    int id = 2;
+    size_t size = 2;
+    WSDS::internal::Deque* deque = new WSDS::internal::Deque(id, size);
+
+    int ntasks = 1000;
+    std::vector<int> out(ntasks);
+    std::vector<IncrementTask*> tasks(ntasks);
+
+    for (int i = 0; i < ntasks; i++) {
+        tasks[i] = new IncrementTask(i, &out[i]);
+        deque->push_bottom(tasks[i]);
+    }
+
+    ASSERT_EQ(ntasks, deque->get_num_tasks());
+    ASSERT_EQ(1024u, deque->get_size());
+    ASSERT_EQ(9u, deque->get_nretired());
+
+    // oldest task is still at the top after growing
+    ASSERT_EQ(tasks[0], deque->pop_top());
+
+    for (int i = ntasks - 1; i > 0; i--) {
+        ASSERT_EQ(tasks[i], deque->pop_bottom());
+    }
+    ASSERT_EQ(nullptr, deque->pop_bottom());
+
+    for (int i = 0; i < ntasks; i++) {
+        delete tasks[i];
+    }
+    delete deque;
+}
+
+TEST(Deque, growth_during_concurrent_steals) {
+    int id = 2;
+    size_t size = 2;
+    WSDS::internal::Deque* deque = new WSDS::internal::Deque(id, size);
+
+    int nthieves = 3;
+    int ntasks = 100000;
+    std::vector<int> out(ntasks);
+    std::vector<IncrementTask*> tasks(ntasks);
+    for (int i = 0; i < ntasks; i++) {
+        tasks[i] = new IncrementTask(i, &out[i]);
+    }
+
+    // each task is counted every time it is handed out by the deque
+    std::vector<std::atomic<int>> delivered(ntasks);
+    for (int i = 0; i < ntasks; i++) {
+        delivered[i] = 0;
+    }
+    std::atomic<bool> done(false);
+
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < nthieves; t++) {
+        thieves.push_back(std::thread([&] {
+            while (!done.load() || deque->get_num_tasks() > 0) {
+                WSDS::Task* task = deque->pop_top();
+                if (task != nullptr) {
+                    delivered[static_cast<IncrementTask*>(task)->get_in()]++;
+                }
+            }
+        }));
+    }
+
+    // owner pushes in bursts so the deque keeps growing while being stolen
+    // from, popping a few tasks itself between bursts
+    for (int i = 0; i < ntasks; i++) {
+        deque->push_bottom(tasks[i]);
+        if (i % 64 == 63) {
+            for (int k = 0; k < 8; k++) {
+                WSDS::Task* task = deque->pop_bottom();
+                if (task != nullptr) {
+                    delivered[static_cast<IncrementTask*>(task)->get_in()]++;
+                }
+            }
+        }
+    }
+    done = true;
+
+    for (int t = 0; t < nthieves; t++) {
+        thieves[t].join();
+    }
+
+    ASSERT_GT(deque->get_nretired(), 0u);
+    for (int i = 0; i < ntasks; i++) {
+        ASSERT_EQ(1, delivered[i].load());
+        delete tasks[i];
+    }
+    delete deque;
+}
+
+TEST(Deque, stress_one_owner_many_thieves_exactly_once) {
+    int id = 2;
+    size_t size = 4;
+    WSDS::internal::Deque* deque = new WSDS::internal::Deque(id, size);
+
+    int nthieves = 4;
+    int ntasks = 200000;
+    std::vector<int> out(ntasks);
+    std::vector<IncrementTask*> tasks(ntasks);
+    for (int i = 0; i < ntasks; i++) {
+        tasks[i] = new IncrementTask(i, &out[i]);
+    }
+
+    // each task is counted every time it is handed out by the deque
+    std::vector<std::atomic<int>> delivered(ntasks);
+    for (int i = 0; i < ntasks; i++) {
+        delivered[i] = 0;
+    }
+    std::atomic<int> ndelivered(0);
+
+    auto deliver = [&](WSDS::Task* task) {
+        if (task != nullptr) {
+            delivered[static_cast<IncrementTask*>(task)->get_in()]++;
+            ndelivered++;
+        }
+    };
+
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < nthieves; t++) {
+        thieves.push_back(std::thread([&] {
+            while (ndelivered.load() < ntasks) {
+                deliver(deque->pop_top());
+            }
+        }));
+    }
+
+    // owner keeps the deque shallow, so most of its pops race the thieves
+    // for the last remaining task
+    int next = 0;
+    while (ndelivered.load() < ntasks) {
+        int burst = (next % 3) + 1;
+        for (int k = 0; k < burst && next < ntasks; k++) {
+            deque->push_bottom(tasks[next++]);
+        }
+        deliver(deque->pop_bottom());
+    }
+
+    for (int t = 0; t < nthieves; t++) {
+        thieves[t].join();
+    }
+
+    ASSERT_EQ(ntasks, ndelivered.load());
+    ASSERT_EQ(0, deque->get_num_tasks());
+    for (int i = 0; i < ntasks; i++) {
+        ASSERT_EQ(1, delivered[i].load());
+        delete tasks[i];
+    }
+    delete deque;
+}
+
+TEST(Deque, batch_steal_takes_half) {
+    WSDS::internal::Deque* victim = new WSDS::internal::Deque(0, 16);
+    WSDS::internal::Deque* thief = new WSDS::internal::Deque(1, 4);
+
+    int ntasks = 10;
+    std::vector<int> out(ntasks);
+    std::vector<IncrementTask*> tasks(ntasks);
+    for (int i = 0; i < ntasks; i++) {
+        tasks[i] = new IncrementTask(i, &out[i]);
+        victim->push_bottom(tasks[i]);
+    }
+
+    // oldest task is returned, the next four move to the thief's deque
+    WSDS::Task* stolen_task = victim->pop_top_batch(thief, 32);
+
+    ASSERT_EQ(tasks[0], stolen_task);
+    ASSERT_EQ(5, victim->get_num_tasks());
+    ASSERT_EQ(4, thief->get_num_tasks());
+    ASSERT_EQ(tasks[4], thief->pop_bottom());
+    ASSERT_EQ(tasks[1], thief->pop_top());
+
+    // batch is capped by maxTasks
+    stolen_task = victim->pop_top_batch(thief, 2);
+
+    ASSERT_EQ(tasks[5], stolen_task);
+    ASSERT_EQ(3, victim->get_num_tasks());
+    ASSERT_EQ(3, thief->get_num_tasks());
+    ASSERT_EQ(tasks[6], thief->pop_bottom());
+
+    for (int i = 0; i < ntasks; i++) {
+        delete tasks[i];
+    }
+    delete victim;
+    delete thief;
+}
+
+TEST(Deque, stress_one_owner_many_batch_thieves_exactly_once) {
+    int id = 2;
+    size_t size = 4;
+    WSDS::internal::Deque* deque = new WSDS::internal::Deque(id, size);
+
+    int nthieves = 4;
+    int ntasks = 200000;
+    std::vector<int> out(ntasks);
+    std::vector<IncrementTask*> tasks(ntasks);
+    for (int i = 0; i < ntasks; i++) {
+        tasks[i] = new IncrementTask(i, &out[i]);
+    }
+
+    // each task is counted every time it is handed out by the deque
+    std::vector<std::atomic<int>> delivered(ntasks);
+    for (int i = 0; i < ntasks; i++) {
+        delivered[i] = 0;
+    }
+    std::atomic<int> ndelivered(0);
+
+    auto deliver = [&](WSDS::Task* task) {
+        if (task != nullptr) {
+            delivered[static_cast<IncrementTask*>(task)->get_in()]++;
+            ndelivered++;
+        }
+    };
+
+    // thieves steal in batches into their own deques, and drain them
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < nthieves; t++) {
+        thieves.push_back(std::thread([&, t] {
+            WSDS::internal::Deque own(t + 3);
+            while (ndelivered.load() < ntasks) {
+                deliver(deque->pop_top_batch(&own, 8));
+                for (WSDS::Task* task = own.pop_bottom(); task != nullptr; task = own.pop_bottom()) {
+                    deliver(task);
+                }
+            }
+        }));
+    }
+
+    // owner pushes bursts deep enough for batches, while popping some back
+    int next = 0;
+    while (ndelivered.load() < ntasks) {
+        int burst = (next % 7) + 1;
+        for (int k = 0; k < burst && next < ntasks; k++) {
+            deque->push_bottom(tasks[next++]);
+        }
+        deliver(deque->pop_bottom());
+    }
+
+    for (int t = 0; t < nthieves; t++) {
+        thieves[t].join();
+    }
+
+    ASSERT_EQ(ntasks, ndelivered.load());
+    ASSERT_EQ(0, deque->get_num_tasks());
+    for (int i = 0; i < ntasks; i++) {
+        ASSERT_EQ(1, delivered[i].load());
+        delete tasks[i];
+    }
+    delete deque;
+}
+
+TEST(Deque, steal_from_empty_deque_is_not_an_abort) {
+    WSDS::internal::Deque* deque = new WSDS::internal::Deque(2, 8);
+
+    int out;
+    IncrementTask* task = new IncrementTask(1, &out);
+
+    bool aborted = true;
+    ASSERT_EQ(nullptr, deque->pop_top(&aborted));
+    ASSERT_FALSE(aborted);
+
+    deque->push_bottom(task);
+    ASSERT_EQ(task, deque->pop_top(&aborted));
+    ASSERT_FALSE(aborted);
+
+    aborted = true;
+    ASSERT_EQ(nullptr, deque->pop_top_batch(deque, 8, &aborted));
+    ASSERT_FALSE(aborted);
+
+    delete task;
+    delete deque;
+}
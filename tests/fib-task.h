@@ -52,4 +52,48 @@ private:
 
 };
 
+/*
+ * Same as FibTask, but allocates its children from the worker arenas.
+ */
+class ArenaFibTask : public WSDS::Task {
+
+public:
+    ArenaFibTask(int n, long* out) {
+        this->n = n;
+        this->out = out;
+    }
+
+    // WSDS Worker will call execute() to process the task
+    void execute() {
+        // fib(1) and fib(2) are both 1
+        if (n <= 2) {
+            *out = 1;
+            return;
+        }
+
+        // if here, spawn a task for fib(n-1) and fib(n-2)
+        long x;
+        WSDS::Task* task1 = WSDS::Task::create<ArenaFibTask>(n-1, &x);
+        spawn(task1);
+
+        long y;
+        WSDS::Task* task2 = WSDS::Task::create<ArenaFibTask>(n-2, &y);
+        spawn(task2);
+
+        // wait for all spawned child tasks to finish
+        wait();
+
+        WSDS::Task::recycle(task1);
+        WSDS::Task::recycle(task2);
+
+        // fib(n) = fib(n-1) + fib(n-2)
+        *out = x + y;
+    }
+
+private:
+    int n;
+    long* out;
+
+};
+
 #endif // _FIB_TASK_DEFINE
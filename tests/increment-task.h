@@ -25,6 +25,8 @@ public:
         *this->out = this->in + 1;
     }
 
+    int get_in(void) { return this->in; }
+
 private:
     int in;
     int* out;
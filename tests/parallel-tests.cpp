@@ -0,0 +1,238 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#define _UNIT_TESTING
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include "scheduler.h"
+#include "parallel.h"
+
+// Google Unit Testing Framework
+#include <gtest/gtest.h>
+
+// runs parallel_for over [0, size) and checks every index is visited once,
+// in subranges of at most grain indices
+void check_parallel_for(WSDS::Scheduler* scheduler, int size, int grain) {
+    std::vector<std::atomic<int>> visits(size);
+    std::atomic<int> oversized(0);
+
+    WSDS::parallel_for(0, size, grain, [&](int begin, int end) {
+        if (end - begin > std::max(grain, 1)) {
+            oversized++;
+        }
+        for (int i = begin; i < end; i++) {
+            visits[i]++;
+        }
+    }, scheduler);
+
+    ASSERT_EQ(0, oversized.load());
+    for (int i = 0; i < size; i++) {
+        ASSERT_EQ(1, visits[i].load()) << "index " << i;
+    }
+}
+
+TEST(Parallel, parallel_for_work_stealing) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(4);
+
+    check_parallel_for(scheduler, 100000, 64);
+    check_parallel_for(scheduler, 1000, 7);
+
+    delete scheduler;
+}
+
+TEST(Parallel, parallel_for_round_robin) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(4, WSDS::ROUND_ROBIN);
+
+    check_parallel_for(scheduler, 10000, 64);
+
+    delete scheduler;
+}
+
+TEST(Parallel, parallel_for_range_smaller_than_grain) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(4);
+
+    check_parallel_for(scheduler, 10, 64);
+    check_parallel_for(scheduler, 1, 64);
+
+    delete scheduler;
+}
+
+TEST(Parallel, parallel_for_empty_range_and_zero_grain) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(4);
+
+    check_parallel_for(scheduler, 0, 64);
+    check_parallel_for(scheduler, 100, 0);
+
+    // the body never runs on an empty range
+    bool called = false;
+    WSDS::parallel_for(5, 5, 1, [&](int, int) { called = true; }, scheduler);
+    WSDS::parallel_for(5, 3, 1, [&](int, int) { called = true; }, scheduler);
+    ASSERT_FALSE(called);
+
+    delete scheduler;
+}
+
+TEST(Parallel, outside_task_without_scheduler_asserts) {
+    int values[4] = {1, 2, 3, 4};
+
+    ASSERT_DEATH(WSDS::parallel_for(0, 4, 1, [](int, int) {}), "a scheduler must be given");
+    ASSERT_DEATH(WSDS::parallel_reduce(0, 4, 1, 0, [](int, int) { return 0; }, std::plus<int>()),
+                 "a scheduler must be given");
+    ASSERT_DEATH(WSDS::parallel_scan(values, values, 4, 1, 0, std::plus<int>()), "a scheduler must be given");
+}
+
+TEST(Parallel, nested_parallel_for_inside_task) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(4);
+
+    const int rows = 64;
+    const int cols = 1000;
+    std::vector<long> sums(rows);
+
+    scheduler->spawn([&] {
+        WSDS::parallel_for(0, rows, 1, [&](int begin, int end) {
+            for (int row = begin; row < end; row++) {
+                std::vector<long> partial(cols);
+                WSDS::parallel_for(0, cols, 16, [&](int first, int last) {
+                    for (int col = first; col < last; col++) {
+                        partial[col] = (long)row * col;
+                    }
+                });
+                for (int col = 0; col < cols; col++) {
+                    sums[row] += partial[col];
+                }
+            }
+        });
+    });
+    scheduler->wait();
+
+    for (int row = 0; row < rows; row++) {
+        ASSERT_EQ((long)row * cols * (cols - 1) / 2, sums[row]);
+    }
+
+    delete scheduler;
+}
+
+TEST(Parallel, parallel_reduce_sum) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(4);
+
+    const int size = 1 << 20;
+    std::vector<int> in(size);
+    for (int i = 0; i < size; i++) {
+        in[i] = i + 1;
+    }
+
+    long sum = WSDS::parallel_reduce(0, size, 1024, 0L, [&](int begin, int end) {
+        long partial = 0;
+        for (int i = begin; i < end; i++) {
+            partial += in[i];
+        }
+        return partial;
+    }, [](long a, long b) { return a + b; }, scheduler);
+
+    ASSERT_EQ((long)size * (size + 1) / 2, sum);
+
+    delete scheduler;
+}
+
+TEST(Parallel, parallel_reduce_keeps_order) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(4, WSDS::ROUND_ROBIN);
+
+    // concatenating is associative, but not commutative
+    std::string digits = WSDS::parallel_reduce(0, 1000, 3, std::string(), [](int begin, int end) {
+        std::string partial;
+        for (int i = begin; i < end; i++) {
+            partial += (char)('0' + i % 10);
+        }
+        return partial;
+    }, [](const std::string& a, const std::string& b) { return a + b; }, scheduler);
+
+    ASSERT_EQ(1000u, digits.size());
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_EQ((char)('0' + i % 10), digits[i]) << "index " << i;
+    }
+
+    delete scheduler;
+}
+
+TEST(Parallel, parallel_reduce_empty_range_and_inside_task) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(4);
+
+    auto count = [](int begin, int end) { return end - begin; };
+    auto add = [](int a, int b) { return a + b; };
+
+    ASSERT_EQ(42, WSDS::parallel_reduce(7, 7, 4, 42, count, add, scheduler));
+
+    int total = 0;
+    scheduler->spawn([&] {
+        total = WSDS::parallel_reduce(0, 100000, 0, 0, count, add);
+    });
+    scheduler->wait();
+
+    ASSERT_EQ(100000, total);
+
+    delete scheduler;
+}
+
+// runs parallel_scan over 1..size and checks it against a sequential scan
+void check_parallel_scan(WSDS::Scheduler* scheduler, int size, int grain, int mode, bool inPlace) {
+    std::vector<long> in(size);
+    for (int i = 0; i < size; i++) {
+        in[i] = i + 1;
+    }
+    std::vector<long> out(size, -1);
+    long* dest = inPlace ? in.data() : out.data();
+
+    WSDS::parallel_scan(in.data(), dest, (long)size, (long)grain, 0L,
+                        [](long a, long b) { return a + b; }, mode, scheduler);
+
+    for (long i = 0; i < size; i++) {
+        long expected = (mode == WSDS::INCLUSIVE_SCAN) ? (i + 1) * (i + 2) / 2 : i * (i + 1) / 2;
+        ASSERT_EQ(expected, dest[i]) << "index " << i;
+    }
+}
+
+TEST(Parallel, parallel_scan_inclusive_and_exclusive) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(4);
+
+    for (int mode : {WSDS::INCLUSIVE_SCAN, WSDS::EXCLUSIVE_SCAN}) {
+        check_parallel_scan(scheduler, 100000, 256, mode, false);
+        check_parallel_scan(scheduler, 100000, 256, mode, true);
+
+        // short last blocks and lanes, more lane sums than fit in a block
+        check_parallel_scan(scheduler, 12345, 17, mode, false);
+        check_parallel_scan(scheduler, 1000, 0, mode, true);
+
+        // a single short block
+        check_parallel_scan(scheduler, 3, 256, mode, false);
+    }
+    check_parallel_scan(scheduler, 0, 256, WSDS::INCLUSIVE_SCAN, false);
+
+    delete scheduler;
+}
+
+TEST(Parallel, parallel_scan_keeps_order) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(4, WSDS::RANDOM);
+
+    // concatenating is associative, but not commutative
+    const int size = 300;
+    std::vector<std::string> in(size);
+    for (int i = 0; i < size; i++) {
+        in[i] = std::string(1, (char)('a' + i % 26));
+    }
+    std::vector<std::string> out(size);
+
+    WSDS::parallel_scan(in.data(), out.data(), size, 5, std::string(),
+                        [](const std::string& a, const std::string& b) { return a + b; },
+                        WSDS::INCLUSIVE_SCAN, scheduler);
+
+    std::string expected;
+    for (int i = 0; i < size; i++) {
+        expected += in[i];
+        ASSERT_EQ(expected, out[i]) << "index " << i;
+    }
+
+    delete scheduler;
+}
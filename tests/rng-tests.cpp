@@ -0,0 +1,53 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#define _UNIT_TESTING
+
+#include <thread>
+#include <vector>
+#include "rng.h"
+
+// Google Unit Testing Framework
+#include <gtest/gtest.h>
+
+TEST(XorShift, zero_seed_still_random) {
+    WSDS::internal::XorShift rng(0);
+
+    uint32_t first = rng.next();
+    uint32_t second = rng.next();
+
+    ASSERT_NE(first, second);
+}
+
+TEST(XorShift, next_int_in_range_and_covers_it) {
+    WSDS::internal::XorShift rng(42);
+
+    int n = 7;
+    std::vector<int> counts(n);
+    for (int i = 0; i < 7000; i++) {
+        int value = rng.next_int(n);
+        ASSERT_LE(0, value);
+        ASSERT_GT(n, value);
+        counts[value]++;
+    }
+
+    // roughly uniform
+    for (int i = 0; i < n; i++) {
+        ASSERT_LT(700, counts[i]);
+        ASSERT_GT(1300, counts[i]);
+    }
+}
+
+TEST(XorShift, threads_get_their_own_generator) {
+    WSDS::internal::XorShift* main_rng = &WSDS::internal::XorShift::local();
+    ASSERT_EQ(main_rng, &WSDS::internal::XorShift::local());
+
+    WSDS::internal::XorShift* thread_rng = nullptr;
+    std::thread thread([&] {
+        thread_rng = &WSDS::internal::XorShift::local();
+    });
+    thread.join();
+
+    ASSERT_NE(main_rng, thread_rng);
+}
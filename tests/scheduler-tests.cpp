@@ -7,6 +7,7 @@
 #include "scheduler.h"
 #include "increment-task.h"
 #include "fib-task.h"
+#include <sched.h>
 
 // Google Unit Testing Framework
 #include <gtest/gtest.h>
@@ -62,6 +63,199 @@ TEST(Scheduler, spawn_and_wait_fib_task_work_stealing) {
     delete scheduler;
 }
 
+TEST(Scheduler, spawn_and_wait_arena_fib_task_work_stealing) {
+    int nworkers = 4;
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(nworkers);
+
+    ASSERT_EQ(WSDS::WORK_STEALING, scheduler->get_workerAlg());
+
+    int in = 15;
+    long out;
+    ArenaFibTask* task = WSDS::Task::create<ArenaFibTask>(in, &out);
+
+    scheduler->spawn(task);
+    scheduler->wait();
+
+    ASSERT_EQ(610, out);
+
+    WSDS::Stats stats = scheduler->stats();
+    ASSERT_LE(stats.steals, stats.stealAttempts);
+    ASSERT_LE(stats.abortedSteals, stats.stealAttempts);
+    ASSERT_EQ(1219, stats.tasksExecuted); // fib(15) tree, root included
+    ASSERT_EQ(1219 - 1, stats.tasksSpawned);
+
+    scheduler->reset_stats();
+    stats = scheduler->stats();
+    ASSERT_EQ(0, stats.tasksExecuted);
+    ASSERT_EQ(0, stats.stealAttempts);
+
+    WSDS::Task::recycle(task);
+    delete scheduler;
+}
+
+// wait up to a second for all workers of an idle scheduler to park
+bool all_workers_parked(WSDS::Scheduler* scheduler) {
+    for (int i = 0; i < 1000; i++) {
+        if (scheduler->get_nsleepers() == scheduler->get_nworkers()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+TEST(Scheduler, idle_workers_park_and_wake_work_stealing) {
+    int nworkers = 4;
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(nworkers);
+
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(all_workers_parked(scheduler));
+
+        int in = 15;
+        long out;
+        FibTask* task = new FibTask(in, &out);
+
+        scheduler->spawn(task);
+        scheduler->wait();
+
+        ASSERT_EQ(610, out);
+
+        delete task;
+    }
+
+    delete scheduler;
+}
+
+TEST(Scheduler, idle_time_counts_parked_workers) {
+    int nworkers = 4;
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(nworkers);
+
+    ASSERT_TRUE(all_workers_parked(scheduler));
+
+    // parked workers never find work, yet their idle time keeps growing
+    scheduler->reset_stats();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    WSDS::Stats stats = scheduler->stats();
+    ASSERT_GE(stats.idleTime, nworkers * 0.05);
+    ASSERT_EQ(0, stats.tasksExecuted);
+
+    delete scheduler;
+}
+
+TEST(Scheduler, idle_workers_park_and_wake_round_robin) {
+    int nworkers = 4;
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(nworkers, WSDS::ROUND_ROBIN);
+
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(all_workers_parked(scheduler));
+
+        int in = 10;
+        long out;
+        FibTask* task = new FibTask(in, &out);
+
+        scheduler->spawn(task);
+        scheduler->wait();
+
+        ASSERT_EQ(55, out);
+
+        delete task;
+    }
+
+    delete scheduler;
+}
+
+TEST(Scheduler, sleeper_count_stays_exact_under_bursts) {
+    int nworkers = 4;
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(nworkers);
+
+    // watch the sleeper count while bursts of work wake workers up, often
+    // just as they are about to park
+    std::atomic_bool done(false);
+    std::atomic_int overcounted(0);
+    std::thread watcher([&] {
+        while (!done.load()) {
+            if (scheduler->get_nsleepers() > nworkers) {
+                overcounted++;
+            }
+        }
+    });
+
+    std::atomic_int ran(0);
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < 16; i++) {
+            scheduler->spawn([&] { ran++; });
+        }
+        scheduler->wait();
+
+        // idle for a varying while, so the next burst catches workers in
+        // every stage of parking
+        std::this_thread::sleep_for(std::chrono::microseconds((round % 8) * 50));
+    }
+
+    done = true;
+    watcher.join();
+
+    ASSERT_EQ(200 * 16, ran.load());
+    ASSERT_EQ(0, overcounted.load());
+
+    // once quiet, exactly every worker is parked, none of them twice
+    ASSERT_TRUE(all_workers_parked(scheduler));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(nworkers, scheduler->get_nsleepers());
+
+    delete scheduler;
+}
+
+TEST(Scheduler, spawn_and_wait_fib_task_pinned) {
+    int nworkers = 4;
+    int pinnings[] = {WSDS::PIN_COMPACT, WSDS::PIN_SCATTER};
+
+    for (int pinning : pinnings) {
+        WSDS::Scheduler* scheduler = new WSDS::Scheduler(nworkers, WSDS::WORK_STEALING, pinning);
+
+        // every worker placed on a CPU the process may run on
+        cpu_set_t allowed;
+        ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+        ASSERT_EQ(pinning, scheduler->get_pinning());
+        for (int i = 0; i < nworkers; i++) {
+            int cpu = scheduler->get_workers()[i].cpu;
+            ASSERT_LE(0, cpu);
+            ASSERT_TRUE(CPU_ISSET(cpu, &allowed));
+        }
+
+        int in = 15;
+        long out;
+        FibTask* task = new FibTask(in, &out);
+
+        scheduler->spawn(task);
+        scheduler->wait();
+
+        ASSERT_EQ(610, out);
+
+        delete task;
+        delete scheduler;
+    }
+}
+
+TEST(Scheduler, round_robin_next_worker_cycles) {
+    int nworkers = 4;
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(nworkers, WSDS::ROUND_ROBIN);
+
+    WSDS::internal::Worker* first = scheduler->next_worker();
+    for (int round = 0; round < 3; round++) {
+        std::vector<bool> seen(nworkers, false);
+        for (int i = 0; i < nworkers; i++) {
+            WSDS::internal::Worker* worker = (round == 0 && i == 0) ? first : scheduler->next_worker();
+            seen[worker->get_id()] = true;
+        }
+        for (int i = 0; i < nworkers; i++) {
+            ASSERT_TRUE(seen[i]);
+        }
+    }
+
+    delete scheduler;
+}
+
 TEST(Scheduler, spawn_and_wait_fib_task_round_robin) {
     int nworkers = 4;
     int workerAlg = WSDS::ROUND_ROBIN;
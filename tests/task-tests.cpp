@@ -17,3 +17,30 @@ TEST(Task, creating_and_deleting) {
 
     delete task;
 }
+
+TEST(Task, create_and_recycle) {
+    int in = 2;
+    int out;
+    IncrementTask* task = WSDS::Task::create<IncrementTask>(in, &out);
+
+    task->execute();
+    ASSERT_EQ(3, out);
+
+    WSDS::Task::recycle(task);
+}
+
+TEST(Task, no_blocking_state_in_task) {
+    // completion is tracked in a single atomic word, waiting on root
+    // tasks is done by the scheduler
+    ASSERT_LE(sizeof(WSDS::Task), 32u);
+}
+
+TEST(Task, create_lambda_and_execute) {
+    int out = 0;
+    WSDS::Task* task = WSDS::Task::create_lambda([&out] { out = 3; });
+
+    task->execute();
+    ASSERT_EQ(3, out);
+
+    WSDS::Task::recycle(task);
+}
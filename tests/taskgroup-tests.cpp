@@ -0,0 +1,120 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#define _UNIT_TESTING
+
+#include <atomic>
+#include "scheduler.h"
+#include "taskgroup.h"
+
+// Google Unit Testing Framework
+#include <gtest/gtest.h>
+
+// fib(n) with both halves spawned as lambdas
+long lambda_fib(int n) {
+    if (n <= 2) {
+        return 1;
+    }
+
+    long x, y;
+    WSDS::TaskGroup group;
+    group.spawn([&] { x = lambda_fib(n-1); });
+    group.spawn([&] { y = lambda_fib(n-2); });
+    group.sync();
+
+    return x + y;
+}
+
+// callable counting how many copies of it are alive
+class CountedFunc {
+
+public:
+    CountedFunc(std::atomic<int>* live, std::atomic<int>* calls) : live(live), calls(calls) { (*live)++; }
+    CountedFunc(const CountedFunc& other) : live(other.live), calls(other.calls) { (*live)++; }
+    ~CountedFunc() { (*live)--; }
+
+    void operator()() { (*calls)++; }
+
+private:
+    std::atomic<int>* live;
+    std::atomic<int>* calls;
+
+};
+
+TEST(TaskGroup, lambda_fib_work_stealing) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(4);
+
+    long out;
+    scheduler->spawn([&] { out = lambda_fib(15); });
+    scheduler->wait();
+
+    ASSERT_EQ(610, out);
+
+    WSDS::Stats stats = scheduler->stats();
+    ASSERT_EQ(1219, stats.tasksExecuted); // fib(15) tree, root included
+    ASSERT_EQ(1219 - 1, stats.tasksSpawned);
+
+    delete scheduler;
+}
+
+TEST(TaskGroup, lambda_fib_round_robin) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(4, WSDS::ROUND_ROBIN);
+
+    long out;
+    scheduler->spawn([&] { out = lambda_fib(12); });
+    scheduler->wait();
+
+    ASSERT_EQ(144, out);
+
+    delete scheduler;
+}
+
+TEST(TaskGroup, group_of_root_tasks) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(4);
+
+    long out[8];
+    {
+        WSDS::TaskGroup group(scheduler);
+        for (int i = 0; i < 8; i++) {
+            group.spawn([&out, i] { out[i] = lambda_fib(10 + i); });
+        }
+        group.sync();
+
+        ASSERT_EQ(55, out[0]);
+        ASSERT_EQ(1597, out[7]);
+
+        // a second round in the same group, synced when leaving scope
+        group.spawn([&out] { out[0] = lambda_fib(20); });
+    }
+
+    ASSERT_EQ(6765, out[0]);
+
+    delete scheduler;
+}
+
+TEST(TaskGroup, lambda_tasks_recycled_after_finishing) {
+    WSDS::Scheduler* scheduler = new WSDS::Scheduler(4);
+
+    std::atomic<int> live(0);
+    std::atomic<int> calls(0);
+
+    scheduler->spawn([&] {
+        WSDS::TaskGroup group;
+        for (int i = 0; i < 100; i++) {
+            group.spawn(CountedFunc(&live, &calls));
+        }
+    });
+    scheduler->wait();
+
+    // the callables are destroyed before their tasks finish, so before
+    // wait() returns
+    ASSERT_EQ(100, calls.load());
+    ASSERT_EQ(0, live.load());
+
+    delete scheduler;
+}
+
+TEST(TaskGroup, outside_task_without_scheduler_asserts) {
+    ASSERT_DEATH(WSDS::TaskGroup group, "a scheduler must be given");
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#define _UNIT_TESTING
+
+#include "topology.h"
+#include <sched.h>
+
+// Google Unit Testing Framework
+#include <gtest/gtest.h>
+
+// two nodes with two cores each, and two SMT threads per core, numbered
+// the way Linux usually does: second SMT threads after all first ones
+std::vector<WSDS::internal::CpuInfo> two_node_layout() {
+    std::vector<WSDS::internal::CpuInfo> cpus;
+    for (int cpu = 0; cpu < 8; cpu++) {
+        int core = cpu % 4;
+        int node = core / 2;
+        cpus.push_back({cpu, node, node, core});
+    }
+    return cpus;
+}
+
+TEST(Topology, reads_system_layout) {
+    WSDS::internal::Topology topology;
+
+    ASSERT_LE(1, topology.get_ncpus());
+
+    std::vector<WSDS::internal::CpuInfo> placement = topology.placement(4, WSDS::PIN_COMPACT);
+    ASSERT_EQ(4u, placement.size());
+}
+
+TEST(Topology, compact_placement) {
+    WSDS::internal::Topology topology(two_node_layout());
+
+    std::vector<WSDS::internal::CpuInfo> placement = topology.placement(8, WSDS::PIN_COMPACT);
+
+    // SMT siblings first, then the next core of the node, then the next node
+    int expected[] = {0, 4, 1, 5, 2, 6, 3, 7};
+    for (int i = 0; i < 8; i++) {
+        ASSERT_EQ(expected[i], placement[i].cpu);
+    }
+    ASSERT_EQ(0, placement[3].node);
+    ASSERT_EQ(1, placement[4].node);
+}
+
+TEST(Topology, scatter_placement) {
+    WSDS::internal::Topology topology(two_node_layout());
+
+    std::vector<WSDS::internal::CpuInfo> placement = topology.placement(8, WSDS::PIN_SCATTER);
+
+    // alternate nodes, use every core before any second SMT thread
+    int expected[] = {0, 2, 1, 3, 4, 6, 5, 7};
+    for (int i = 0; i < 8; i++) {
+        ASSERT_EQ(expected[i], placement[i].cpu);
+        ASSERT_EQ(i % 2, placement[i].node);
+    }
+}
+
+TEST(Topology, placement_wraps_around) {
+    WSDS::internal::Topology topology(two_node_layout());
+
+    std::vector<WSDS::internal::CpuInfo> placement = topology.placement(10, WSDS::PIN_COMPACT);
+
+    ASSERT_EQ(10u, placement.size());
+    ASSERT_EQ(placement[0].cpu, placement[8].cpu);
+    ASSERT_EQ(placement[1].cpu, placement[9].cpu);
+}
+
+TEST(Topology, keeps_only_allowed_cpus) {
+    cpu_set_t original;
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(original), &original));
+
+    // restrict ourselves to the last CPU we may run on, like taskset would
+    int last = -1;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &original)) {
+            last = cpu;
+        }
+    }
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(last, &one);
+    ASSERT_EQ(0, sched_setaffinity(0, sizeof(one), &one));
+
+    WSDS::internal::Topology topology;
+    std::vector<WSDS::internal::CpuInfo> placement = topology.placement(4, WSDS::PIN_SCATTER);
+
+    ASSERT_EQ(0, sched_setaffinity(0, sizeof(original), &original));
+
+    ASSERT_EQ(1, topology.get_ncpus());
+    for (WSDS::internal::CpuInfo& info : placement) {
+        ASSERT_EQ(last, info.cpu);
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2020 Bryson Banks and David Campbell.  All rights reserved.
+ */
+
+#define _UNIT_TESTING
+
+#include <sstream>
+#include "trace.h"
+
+// Google Unit Testing Framework
+#include <gtest/gtest.h>
+
+TEST(Tracer, records_task_and_steal_events) {
+    WSDS::internal::Tracer* tracer = new WSDS::internal::Tracer(3, 16);
+
+    uint64_t start = WSDS::internal::Tracer::now();
+    tracer->steal(start, 1);
+    tracer->task_begin(7);
+    tracer->task_end(7);
+
+    ASSERT_EQ(3u, tracer->get_nevents());
+
+    std::vector<WSDS::internal::Tracer*> tracers = {tracer};
+    std::ostringstream out;
+    WSDS::internal::Tracer::write_json(out, tracers);
+    std::string json = out.str();
+
+    ASSERT_NE(std::string::npos, json.find("\"traceEvents\""));
+    ASSERT_NE(std::string::npos, json.find("\"name\":\"worker 3\""));
+    ASSERT_NE(std::string::npos, json.find("\"name\":\"steal from 1\",\"cat\":\"steal\",\"ph\":\"X\""));
+    ASSERT_NE(std::string::npos, json.find("\"name\":\"task 7\",\"cat\":\"task\",\"ph\":\"B\""));
+    ASSERT_NE(std::string::npos, json.find("\"name\":\"task 7\",\"cat\":\"task\",\"ph\":\"E\""));
+
+    delete tracer;
+}
+
+TEST(Tracer, ring_buffer_keeps_newest_events) {
+    WSDS::internal::Tracer* tracer = new WSDS::internal::Tracer(0, 4);
+
+    for (int i = 0; i < 10; i++) {
+        tracer->task_begin(i);
+    }
+
+    ASSERT_EQ(4u, tracer->get_nevents());
+
+    std::vector<WSDS::internal::Tracer*> tracers = {tracer};
+    std::ostringstream out;
+    WSDS::internal::Tracer::write_json(out, tracers);
+    std::string json = out.str();
+
+    ASSERT_EQ(std::string::npos, json.find("\"task 5\""));
+    ASSERT_NE(std::string::npos, json.find("\"task 6\""));
+    ASSERT_NE(std::string::npos, json.find("\"task 9\""));
+    ASSERT_LT(json.find("\"task 6\""), json.find("\"task 9\""));
+
+    delete tracer;
+}
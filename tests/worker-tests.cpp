@@ -22,3 +22,23 @@ TEST(Worker, creating_and_deleting) {
 
     delete worker;
 }
+
+TEST(Worker, local_victims_counted_separately) {
+    int nvictims = 3;
+    WSDS::internal::Worker* worker = new WSDS::internal::Worker(0, nvictims, nullptr);
+    WSDS::internal::Worker* victim1 = new WSDS::internal::Worker(1, nvictims, nullptr);
+    WSDS::internal::Worker* victim2 = new WSDS::internal::Worker(2, nvictims, nullptr);
+    WSDS::internal::Worker* victim3 = new WSDS::internal::Worker(3, nvictims, nullptr);
+
+    worker->add_victim(victim1, false);
+    worker->add_victim(victim2, true);
+    worker->add_victim(victim3, true);
+
+    ASSERT_EQ(3, worker->get_nvictims());
+    ASSERT_EQ(2, worker->get_nlocalVictims());
+
+    delete worker;
+    delete victim1;
+    delete victim2;
+    delete victim3;
+}